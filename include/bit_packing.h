@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Blocks of PACKED_BLOCK_VALUES 32-bit values packed to a common bit width. Value i belongs to lane i % 4,
+// and each lane stores its values in consecutive bit fields of its own words; the lane words are
+// interleaved, so four values are unpacked with one SSE2 shift and mask.
+const size_t PACKED_BLOCK_VALUES = 128;
+
+// Number of bits needed to store value, 0 for 0
+unsigned BitWidth(uint32_t value);
+
+// Number of 32-bit words of a block packed to bit_width bits
+inline size_t PackedBlockWords(unsigned bit_width) {
+    return bit_width * PACKED_BLOCK_VALUES / 32;
+}
+
+// Writes PackedBlockWords(bit_width) words to out; every value must fit into bit_width bits
+void PackBlock(const uint32_t* values, unsigned bit_width, uint32_t* out);
+
+// Unpacks gaps and restores the increasing sequence they encode:
+// values[i] = base + i + gaps[0] + ... + gaps[i]
+void UnpackBlockGaps(const uint32_t* in, unsigned bit_width, uint32_t base, uint32_t* values);
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// SearchServer that serves queries while it is being changed. It keeps two copies of the index:
+// queries read the published copy, which no writer touches, while a writer changes the other copy,
+// publishes it with one atomic store, waits until the queries still reading the old copy finish, and
+// then replays the change on it. Queries never wait for writers; writers are serialized.
+class ConcurrentSearchServer {
+public:
+    template <typename StringContainer>
+    explicit ConcurrentSearchServer(const StringContainer& stop_words);
+    explicit ConcurrentSearchServer(const std::string_view stop_words_text);
+    explicit ConcurrentSearchServer(const std::string& stop_words_text);
+
+    // Calls reader(const SearchServer&) on the published version, which stays unchanged until it returns
+    template <typename Reader>
+    auto Read(Reader reader) const;
+
+    // Calls updater(SearchServer&) on each copy of the index in turn, so it must change both the same
+    // way. If it throws on the first copy, the change is not published; it must then leave the copy
+    // unchanged, as the SearchServer methods do.
+    template <typename Updater>
+    void Update(Updater updater);
+
+    void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    std::vector<std::exception_ptr> AddDocuments(const std::vector<RawDocument>& documents);
+    void RemoveDocument(int document_id);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
+
+    int GetDocumentCount() const;
+
+private:
+    // Readers of a copy are counted on stripes in separate cache lines, picked by thread
+    static constexpr size_t READER_STRIPE_COUNT = 16;
+
+    struct alignas(64) ReaderStripe {
+        std::atomic<int64_t> count{ 0 };
+    };
+
+    using ReaderCounter = std::array<ReaderStripe, READER_STRIPE_COUNT>;
+
+    class ReadLock {
+    public:
+        explicit ReadLock(const ConcurrentSearchServer& server);
+        ReadLock(const ReadLock&) = delete;
+        ReadLock& operator=(const ReadLock&) = delete;
+        ~ReadLock();
+
+        const SearchServer& GetServer() const;
+
+    private:
+        const ConcurrentSearchServer& server_;
+        std::atomic<int64_t>* reader_count_;
+        size_t index_;
+    };
+
+    std::deque<SearchServer> copies_;
+    std::atomic<size_t> published_index_{ 0 };
+    mutable std::array<ReaderCounter, 2> readers_;
+    std::mutex update_mutex_;
+
+    static size_t GetReaderStripe();
+    void Publish(size_t index);
+};
+
+template <typename StringContainer>
+ConcurrentSearchServer::ConcurrentSearchServer(const StringContainer& stop_words) {
+    copies_.emplace_back(stop_words);
+    copies_.emplace_back(stop_words);
+}
+
+template <typename Reader>
+auto ConcurrentSearchServer::Read(Reader reader) const {
+    const ReadLock lock(*this);
+    return reader(lock.GetServer());
+}
+
+template <typename Updater>
+void ConcurrentSearchServer::Update(Updater updater) {
+    std::lock_guard guard(update_mutex_);
+    const size_t published_index = published_index_.load();
+    updater(copies_[1 - published_index]);
+    Publish(1 - published_index);
+    updater(copies_[published_index]);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(const std::string_view raw_query,
+    DocumentPredicate document_predicate, size_t max_result_count) const {
+    return Read([&](const SearchServer& server) {
+        return server.FindTopDocuments(raw_query, document_predicate, max_result_count);
+        });
+}
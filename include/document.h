@@ -1,5 +1,8 @@
 #pragma once
 
+#include <string_view>
+#include <vector>
+
 struct Document {
     Document() = default;
 
@@ -19,4 +22,11 @@ enum class DocumentStatus {
     IRRELEVANT,
     BANNED,
     REMOVED,
-};
\ No newline at end of file
+};
+
+struct RawDocument {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "document.h"
+#include "posting_list.h"
+
+inline uint32_t DocumentStatusBit(DocumentStatus status) {
+    return uint32_t{1} << static_cast<unsigned>(status);
+}
+
+// Conjunction of simple conditions on the attributes of a document. It can be passed wherever a document
+// predicate is expected; the search servers recognize it and check blocks of candidates at once.
+struct AttributeFilter {
+    int min_rating = std::numeric_limits<int>::min();
+    int max_rating = std::numeric_limits<int>::max();
+    // Combination of DocumentStatusBit values of the admitted statuses
+    uint32_t status_mask = ~uint32_t{0};
+    // Admits ids with id % id_divisor == id_remainder; the divisor must be positive
+    uint32_t id_divisor = 1;
+    uint32_t id_remainder = 0;
+
+    bool operator()(int document_id, DocumentStatus status, int rating) const {
+        return rating >= min_rating && rating <= max_rating
+            && (status_mask & DocumentStatusBit(status)) != 0
+            && static_cast<uint32_t>(document_id) % id_divisor == id_remainder;
+    }
+};
+
+// Id, rating and status of the documents in separate arrays indexed by slot
+class DocumentAttributes {
+public:
+    void Append(int document_id, int rating, DocumentStatus status);
+    void Reserve(size_t count);
+
+    size_t size() const {
+        return ids_.size();
+    }
+
+    int GetId(DocumentSlot slot) const {
+        return ids_[slot];
+    }
+
+    int GetRating(DocumentSlot slot) const {
+        return ratings_[slot];
+    }
+
+    DocumentStatus GetStatus(DocumentSlot slot) const {
+        return static_cast<DocumentStatus>(statuses_[slot]);
+    }
+
+    // Takes slots relative to first and moves those of the documents that pass the filter to the front,
+    // keeping their order; returns their number. Four documents are checked at a time with SSE2.
+    size_t Filter(const AttributeFilter& filter, DocumentSlot first, DocumentSlot* local_slots, size_t count) const;
+
+private:
+    std::vector<int> ids_;
+    std::vector<int> ratings_;
+    std::vector<uint8_t> statuses_;
+};
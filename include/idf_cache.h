@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+
+#include "term_dictionary.h"
+
+// Lazily computed per-term inverse document frequencies. A cached value is valid while its
+// version matches the corpus version, which the owner bumps on every change of the corpus.
+// When frozen, cached values never go stale, so queries stop recomputing them altogether.
+// Get may be called concurrently; all other methods require exclusive access.
+class IdfCache {
+public:
+    void Resize(size_t term_count) {
+        while (entries_.size() < term_count) {
+            entries_.emplace_back();
+        }
+    }
+
+    void Reset(size_t term_count) {
+        entries_.clear();
+        Resize(term_count);
+        ++version_;
+    }
+
+    void Invalidate() {
+        ++version_;
+    }
+
+    void Freeze() {
+        frozen_ = true;
+    }
+
+    void Unfreeze() {
+        frozen_ = false;
+        ++version_;
+    }
+
+    bool IsFrozen() const {
+        return frozen_;
+    }
+
+    template <typename ComputeIdf>
+    double Get(TermId term, ComputeIdf compute_idf) const {
+        Entry& entry = entries_[term];
+        const uint64_t entry_version = entry.version.load(std::memory_order_acquire);
+        if (entry_version == version_ || (frozen_ && entry_version != 0)) {
+            return entry.idf.load(std::memory_order_relaxed);
+        }
+        const double idf = compute_idf();
+        entry.idf.store(idf, std::memory_order_relaxed);
+        entry.version.store(version_, std::memory_order_release);
+        return idf;
+    }
+
+private:
+    struct Entry {
+        std::atomic<uint64_t> version{ 0 };
+        std::atomic<double> idf{ 0.0 };
+    };
+
+    mutable std::deque<Entry> entries_;
+    uint64_t version_ = 1;
+    bool frozen_ = false;
+};
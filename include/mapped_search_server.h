@@ -0,0 +1,128 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+#include "mapped_file.h"
+#include "score_accumulator.h"
+#include "search_server.h"
+#include "snapshot_io.h"
+#include "term_dictionary.h"
+#include "top_documents.h"
+
+// Read-only server over a snapshot written by SearchServer::SaveSnapshot. The file is mapped rather
+// than loaded, and queries read postings straight from the mapped pages: opening does no
+// deserialization, and processes serving the same file share one copy of the index in the page cache.
+// Opening only validates the layout of the file. Offsets, slots and terms are range checked as queries
+// read them, and a query that reads an inconsistent entry throws; call VerifyChecksum to check the
+// contents of the whole file.
+class MappedSearchServer {
+public:
+    explicit MappedSearchServer(const std::string& path);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+    // Reads every page of the file
+    bool VerifyChecksum() const;
+
+private:
+    struct Query {
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
+    };
+
+    MappedFile file_;
+    uint64_t term_count_ = 0;
+    uint64_t document_count_ = 0;
+    SnapshotArrayView<uint64_t> term_offsets_;
+    SnapshotArrayView<char> term_chars_;
+    SnapshotArrayView<uint8_t> stop_flags_;
+    SnapshotArrayView<TermId> sorted_terms_;
+    SnapshotArrayView<int> ids_;
+    SnapshotArrayView<int> ratings_;
+    SnapshotArrayView<uint8_t> statuses_;
+    SnapshotArrayView<DocumentSlot> slots_by_id_;
+    SnapshotArrayView<uint64_t> posting_offsets_;
+    SnapshotArrayView<DocumentSlot> posting_slots_;
+    SnapshotArrayView<double> posting_freqs_;
+    SnapshotArrayView<uint64_t> forward_offsets_;
+    SnapshotArrayView<TermId> forward_terms_;
+    SnapshotArrayView<double> forward_freqs_;
+
+    // Throws std::runtime_error unless the condition holds
+    static void CheckContents(bool condition);
+    std::string_view GetWord(TermId term) const;
+    TermId FindTerm(std::string_view word) const;
+    std::optional<DocumentSlot> FindSlot(int document_id) const;
+    // Bounds of the postings of the term in posting_slots_ and posting_freqs_
+    std::pair<uint64_t, uint64_t> GetPostingRange(TermId term) const;
+    bool ContainsTerm(TermId term, DocumentSlot slot) const;
+    double ComputeWordInverseDocumentFreq(TermId term) const;
+    Query ParseQuery(std::string_view text) const;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query,
+    DocumentPredicate document_predicate, size_t max_result_count) const {
+    const Query query = ParseQuery(raw_query);
+
+    ScoreAccumulator& accumulator = ScoreAccumulator::ForCurrentThread();
+    accumulator.Reset(document_count_);
+    // Minus terms are resolved first, as in SearchServer: short lists exclude their documents before
+    // scoring, long ones are probed only for the scored documents
+    uint64_t plus_posting_count = 0;
+    for (const TermId term : query.plus_terms) {
+        const auto [begin, end] = GetPostingRange(term);
+        plus_posting_count += end - begin;
+    }
+    std::vector<TermId> probed_minus_terms;
+    for (const TermId term : query.minus_terms) {
+        const auto [begin, end] = GetPostingRange(term);
+        if (end - begin > MINUS_PROBE_STEP_COST * plus_posting_count * std::log2(end - begin + 1.0)) {
+            probed_minus_terms.push_back(term);
+            continue;
+        }
+        for (uint64_t i = begin; i < end; ++i) {
+            CheckContents(posting_slots_[i] < document_count_);
+            accumulator.Exclude(posting_slots_[i]);
+        }
+    }
+    for (const TermId term : query.plus_terms) {
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(term);
+        const auto [begin, end] = GetPostingRange(term);
+        for (uint64_t i = begin; i < end; ++i) {
+            CheckContents(posting_slots_[i] < document_count_);
+            accumulator.Add(posting_slots_[i], posting_freqs_[i] * inverse_document_freq);
+        }
+    }
+
+    TopDocuments top_documents(max_result_count);
+    for (const DocumentSlot slot : accumulator.GetTouched()) {
+        if (std::any_of(probed_minus_terms.begin(), probed_minus_terms.end(), [this, slot](TermId term) {
+                return ContainsTerm(term, slot);
+            })) {
+            continue;
+        }
+        const auto status = static_cast<DocumentStatus>(statuses_[slot]);
+        if (document_predicate(ids_[slot], status, ratings_[slot])) {
+            top_documents.Push({ ids_[slot], accumulator.GetScore(slot), ratings_[slot] });
+        }
+    }
+    return top_documents.Extract();
+}
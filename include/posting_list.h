@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Dense internal document number, assigned in the order documents are added
+using DocumentSlot = uint32_t;
+
+// Postings of one term in slot order. A compressed list keeps its postings in blocks of up to 128:
+// slot gaps are bit-packed, term frequencies are quantized to 16 bits relative to the block maximum,
+// and the slot range of every block serves as skip data. Postings appended after the last block
+// stay plain until there are enough of them to fill a new block.
+class PostingList {
+public:
+    class RangeReader;
+
+    PostingList() = default;
+    PostingList(std::vector<DocumentSlot> slots, std::vector<double> term_freqs)
+        : slots_(std::move(slots))
+        , term_freqs_(std::move(term_freqs)) {
+        UpdateBlockMaxima(0);
+    }
+
+    void Add(DocumentSlot slot, double term_freq);
+    bool Contains(DocumentSlot slot) const;
+    // Returns 0 if the list does not contain the slot
+    double FindTermFreq(DocumentSlot slot) const;
+
+    size_t size() const {
+        return compressed_size_ + slots_.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // Calls func(slot, term_freq) for the postings with slots in [first, last), in slot order
+    template <typename Func>
+    void ForEachInRange(DocumentSlot first, DocumentSlot last, Func func) const;
+    template <typename Func>
+    void ForEach(Func func) const {
+        ForEachInRange(0, std::numeric_limits<DocumentSlot>::max(), func);
+    }
+
+    template <typename SlotPredicate>
+    void RemoveIf(SlotPredicate predicate);
+
+    // Term frequencies read from a compressed list are quantized
+    void Compress();
+    void Decompress();
+    bool IsCompressed() const {
+        return compressed_;
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64;
+    static constexpr size_t COMPRESSED_BLOCK_SIZE = 128;
+    static constexpr double MAX_QUANTIZED_TERM_FREQ = 65535.0;
+
+    struct CompressedBlock {
+        DocumentSlot first_slot;
+        DocumentSlot last_slot;
+        uint32_t slots_offset;
+        uint32_t term_freqs_offset;
+        double max_term_freq;
+        uint8_t bit_width;
+        uint8_t count;
+    };
+
+    // Postings after the compressed blocks, i.e. all postings of an uncompressed list
+    std::vector<DocumentSlot> slots_;
+    std::vector<double> term_freqs_;
+    std::vector<double> block_max_term_freqs_;
+
+    bool compressed_ = false;
+    size_t compressed_size_ = 0;
+    std::vector<CompressedBlock> blocks_;
+    std::vector<uint32_t> packed_slots_;
+    std::vector<uint16_t> quantized_term_freqs_;
+
+    // Recomputes the maxima of the blocks starting with the one holding position pos
+    void UpdateBlockMaxima(size_t pos);
+
+    // Index of the first compressed block that ends at or after slot
+    size_t FindBlock(DocumentSlot slot) const;
+    // Both return the number of postings in the block; the buffers must hold COMPRESSED_BLOCK_SIZE values
+    size_t DecodeBlock(size_t block, DocumentSlot* slots, double* term_freqs) const;
+    size_t DecodeBlockSlots(size_t block, DocumentSlot* slots) const;
+    // Appends a block with already quantized term frequencies to the given storage
+    static void AppendBlock(const DocumentSlot* slots, const uint16_t* term_freqs, size_t count, double max_term_freq,
+                            std::vector<CompressedBlock>& blocks, std::vector<uint32_t>& packed_slots,
+                            std::vector<uint16_t>& quantized_term_freqs);
+    // Compresses the full blocks at the front of the plain postings
+    void PackPlainPostings();
+    // Moves all compressed postings back to the plain arrays
+    void UnpackBlocks();
+};
+
+// Reads a list through consecutive slot ranges, e.g. the windows of a scoring pass. Each range
+// starts where the previous one ended, so moving on costs a short forward search.
+class PostingList::RangeReader {
+public:
+    RangeReader(const PostingList& postings, DocumentSlot first);
+
+    // The current range becomes [end of the previous range, last)
+    void Advance(DocumentSlot last);
+
+    // Upper bounds of the term frequencies and of the number of postings in the current range
+    double GetMaxTermFreq() const;
+    size_t GetMaxCount() const;
+
+    template <typename Func>
+    void ForEach(Func func) const;
+
+    // Returns 0 if the current range does not contain the slot. Compressed blocks of the range
+    // are decoded on the first lookup and kept until the next Advance.
+    double FindTermFreq(DocumentSlot slot);
+
+private:
+    const PostingList* postings_;
+    DocumentSlot first_;
+    DocumentSlot last_;
+    size_t first_block_ = 0;
+    size_t last_block_ = 0;
+    size_t first_pos_ = 0;
+    size_t last_pos_ = 0;
+    bool is_decoded_ = false;
+    size_t decoded_count_ = 0;
+    std::vector<DocumentSlot> decoded_slots_;
+    std::vector<double> decoded_term_freqs_;
+};
+
+template <typename Func>
+void PostingList::ForEachInRange(DocumentSlot first, DocumentSlot last, Func func) const {
+    if (!blocks_.empty()) {
+        DocumentSlot slots[COMPRESSED_BLOCK_SIZE];
+        double term_freqs[COMPRESSED_BLOCK_SIZE];
+        for (size_t block = FindBlock(first); block < blocks_.size() && blocks_[block].first_slot < last; ++block) {
+            const size_t count = DecodeBlock(block, slots, term_freqs);
+            for (size_t i = 0; i < count; ++i) {
+                if (slots[i] >= first && slots[i] < last) {
+                    func(slots[i], term_freqs[i]);
+                }
+            }
+        }
+    }
+    auto pos = std::lower_bound(slots_.begin(), slots_.end(), first) - slots_.begin();
+    for (; pos < static_cast<ptrdiff_t>(slots_.size()) && slots_[pos] < last; ++pos) {
+        func(slots_[pos], term_freqs_[pos]);
+    }
+}
+
+template <typename Func>
+void PostingList::RangeReader::ForEach(Func func) const {
+    DocumentSlot slots[COMPRESSED_BLOCK_SIZE];
+    double term_freqs[COMPRESSED_BLOCK_SIZE];
+    for (size_t block = first_block_; block < last_block_; ++block) {
+        const size_t count = postings_->DecodeBlock(block, slots, term_freqs);
+        for (size_t i = 0; i < count; ++i) {
+            if (slots[i] >= first_ && slots[i] < last_) {
+                func(slots[i], term_freqs[i]);
+            }
+        }
+    }
+    for (size_t pos = first_pos_; pos < last_pos_; ++pos) {
+        func(postings_->slots_[pos], postings_->term_freqs_[pos]);
+    }
+}
+
+template <typename SlotPredicate>
+void PostingList::RemoveIf(SlotPredicate predicate) {
+    if (!blocks_.empty()) {
+        // Surviving postings keep their quantized values, so compaction does not add rounding error
+        std::vector<CompressedBlock> blocks;
+        std::vector<uint32_t> packed_slots;
+        std::vector<uint16_t> quantized_term_freqs;
+        DocumentSlot slots[COMPRESSED_BLOCK_SIZE];
+        uint16_t term_freqs[COMPRESSED_BLOCK_SIZE];
+        compressed_size_ = 0;
+        for (size_t block = 0; block < blocks_.size(); ++block) {
+            const size_t count = DecodeBlockSlots(block, slots);
+            size_t kept = 0;
+            for (size_t i = 0; i < count; ++i) {
+                if (!predicate(slots[i])) {
+                    slots[kept] = slots[i];
+                    term_freqs[kept] = quantized_term_freqs_[blocks_[block].term_freqs_offset + i];
+                    ++kept;
+                }
+            }
+            if (kept > 0) {
+                AppendBlock(slots, term_freqs, kept, blocks_[block].max_term_freq,
+                            blocks, packed_slots, quantized_term_freqs);
+                compressed_size_ += kept;
+            }
+        }
+        blocks_ = std::move(blocks);
+        packed_slots_ = std::move(packed_slots);
+        quantized_term_freqs_ = std::move(quantized_term_freqs);
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < slots_.size(); ++i) {
+        if (!predicate(slots_[i])) {
+            slots_[kept] = slots_[i];
+            term_freqs_[kept] = term_freqs_[i];
+            ++kept;
+        }
+    }
+    slots_.resize(kept);
+    term_freqs_.resize(kept);
+    UpdateBlockMaxima(0);
+}
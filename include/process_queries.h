@@ -4,13 +4,66 @@
 #include <numeric>
 #include <algorithm>
 #include <execution>
+#include <string>
+#include <string_view>
 #include "search_server.h"
+#include "thread_pool.h"
 #include "document.h"
 
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries);
 
+// Queries are answered in batches of this size while results are streamed out;
+// at most two batches of results are held at a time
+const size_t PROCESS_QUERIES_CHUNK_SIZE = 1024;
+
 std::vector<Document>  ProcessQueriesJoined(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries);
\ No newline at end of file
+    const std::vector<std::string>& queries);
+
+// Passes the documents found for every query to sink in query order, starting before
+// the later queries are answered. The sink may be called on a pool thread, but never concurrently.
+template <typename DocumentSink>
+void ProcessQueriesJoined(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    DocumentSink sink);
+
+template <typename DocumentSink>
+void ProcessQueriesJoined(
+    const SearchServer& search_server,
+    const std::vector<std::string>& queries,
+    DocumentSink sink)
+{
+    const auto process_chunk = [&search_server, &queries](size_t first) {
+        const size_t last = std::min(first + PROCESS_QUERIES_CHUNK_SIZE, queries.size());
+        const std::vector<std::string_view> raw_queries(queries.begin() + first, queries.begin() + last);
+        return search_server.FindTopDocumentsBatch(ThreadPool::Shared(), raw_queries);
+    };
+
+    // The next chunk is answered on the pool while the results of the current one go to the sink
+    std::vector<std::vector<Document>> chunk;
+    std::vector<std::vector<Document>> next_chunk;
+    if (!queries.empty()) {
+        next_chunk = process_chunk(0);
+    }
+    for (size_t first = 0; first < queries.size(); first += PROCESS_QUERIES_CHUNK_SIZE) {
+        chunk = std::move(next_chunk);
+        next_chunk.clear();
+        const size_t next_first = first + PROCESS_QUERIES_CHUNK_SIZE;
+        ThreadPool::Shared().Run(2, [&](size_t i) {
+            if (i == 0) {
+                if (next_first < queries.size()) {
+                    next_chunk = process_chunk(next_first);
+                }
+                return;
+            }
+            for (const std::vector<Document>& documents : chunk) {
+                for (const Document& document : documents) {
+                    sink(document);
+                }
+            }
+            });
+    }
+}
\ No newline at end of file
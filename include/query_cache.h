@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "term_dictionary.h"
+
+// Thread-safe cache of top document results. Entries are spread over shards by key hash, each
+// with its own lock, and every shard is a segmented LRU: new entries are probationary, and only
+// entries hit again move to the protected segment, so a burst of one-off queries can not flush
+// the popular ones. An entry stored for another corpus version counts as a miss and is dropped.
+class QueryCache {
+public:
+    struct Key {
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        size_t max_result_count = 0;
+
+        bool operator==(const Key& other) const {
+            return status == other.status && max_result_count == other.max_result_count
+                && plus_terms == other.plus_terms && minus_terms == other.minus_terms;
+        }
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entry_count = 0;
+        size_t memory_usage = 0;
+    };
+
+    // The memory limit covers the cached results, keys and bookkeeping, as estimated by the cache
+    explicit QueryCache(size_t max_memory_bytes);
+
+    std::optional<std::vector<Document>> Find(const Key& key, uint64_t version);
+    void Insert(const Key& key, const std::vector<Document>& documents, uint64_t version);
+    void Clear();
+
+    Stats GetStats() const;
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+    // Part of a shard's memory that protected entries may take
+    static constexpr double PROTECTED_SHARE = 0.8;
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    // Most recently used first; the keys live in the shard's map
+    using LruList = std::list<const Key*>;
+
+    struct Entry {
+        std::vector<Document> documents;
+        uint64_t version;
+        size_t memory_usage;
+        bool is_protected;
+        LruList::iterator position;
+    };
+
+    using EntryMap = std::unordered_map<Key, Entry, KeyHash>;
+
+    struct Shard {
+        mutable std::mutex mutex;
+        EntryMap entries;
+        LruList probation;
+        LruList protected_entries;
+        size_t memory_usage = 0;
+        size_t protected_memory_usage = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    size_t max_shard_memory_;
+    std::array<Shard, SHARD_COUNT> shards_;
+
+    Shard& GetShard(const Key& key);
+    static size_t EstimateMemoryUsage(const Key& key, const std::vector<Document>& documents);
+    static void Erase(Shard& shard, EntryMap::iterator it);
+    void Protect(Shard& shard, Entry& entry);
+};
@@ -3,3 +3,7 @@
 #include "search_server.h"
 
 void RemoveDuplicates(SearchServer& search_server);
+
+// Goes through the clusters found by SearchServer::FindNearDuplicates by ascending id. A document is removed
+// only if it is at least threshold similar to a document of its cluster that is kept.
+void RemoveNearDuplicates(SearchServer& search_server, double threshold);
@@ -1,6 +1,9 @@
 #pragma once
 
-#include <deque>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <vector>
 
 #include "search_server.h"
@@ -8,8 +11,23 @@
 
 using namespace std::string_literals;
 
+// Statistics of the last WINDOW_SIZE requests. Requests may be added from several threads at once:
+// each one claims a slot of a fixed ring with an atomic counter and writes a compact record there,
+// so adding a request takes no lock and allocates nothing.
 class RequestQueue {
 public:
+    // One request per minute of a day
+    static constexpr size_t WINDOW_SIZE = 1440;
+
+    struct Stats {
+        size_t request_count = 0;
+        size_t no_result_count = 0;
+        double queries_per_second = 0.0;
+        double zero_hit_rate = 0.0;
+        std::chrono::nanoseconds p50_latency{ 0 };
+        std::chrono::nanoseconds p99_latency{ 0 };
+    };
+
     explicit RequestQueue(const SearchServer& search_server);
 
     template <typename DocumentPredicate>
@@ -17,31 +35,38 @@ public:
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string& raw_query);
 
-    int GetNoResultRequests() const {
-        return empty_requests_;
-    }
+    int GetNoResultRequests() const;
+    // Records being written concurrently are left out
+    Stats GetStats() const;
+
 private:
-    struct QueryResult {
-        std::vector<Document> documents_;
-        std::string query_;
+    // The sequence number is 0 while the record is written, otherwise the number of the request
+    // plus one; a reader accepts the fields only if it sees the same nonzero sequence before and after
+    struct Record {
+        std::atomic<uint64_t> sequence{ 0 };
+        std::atomic<int64_t> timestamp{ 0 };
+        std::atomic<int64_t> latency{ 0 };
+        std::atomic<uint32_t> result_count{ 0 };
     };
-    std::deque<QueryResult> requests_;
-    const static int min_in_day_ = 1440;
 
-    const SearchServer& search_server_;
+    struct RecordData {
+        int64_t timestamp;
+        int64_t latency;
+        uint32_t result_count;
+    };
 
-    void AddEmptyRequest(std::vector<Document>& documents_);
-    void DeleteEmptyRequest();
+    const SearchServer& search_server_;
+    std::atomic<uint64_t> request_count_{ 0 };
+    std::array<Record, WINDOW_SIZE> records_;
 
-    int empty_requests_ = 0;
-    std::string empty_query_ = "empty request"s;
+    void AddRecord(std::chrono::steady_clock::time_point start, size_t result_count);
+    std::vector<RecordData> ReadRecords() const;
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-    std::vector<Document> documents_ = search_server_.FindTopDocuments(raw_query, document_predicate);
-    AddEmptyRequest(documents_);
-    requests_.push_back({ documents_, raw_query });
-    DeleteEmptyRequest();
-    return documents_;
-}
\ No newline at end of file
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Document> documents = search_server_.FindTopDocuments(raw_query, document_predicate);
+    AddRecord(start, documents.size());
+    return documents;
+}
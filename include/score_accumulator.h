@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "posting_list.h"
+
+// Flat per-slot relevance accumulator reused between queries. Slots touched by the
+// current query are tracked by a stamp, so starting a new query does not clear the arrays.
+class ScoreAccumulator {
+public:
+    static ScoreAccumulator& ForCurrentThread();
+
+    void Reset(size_t slot_count);
+
+    void Add(DocumentSlot slot, double score) {
+        uint32_t& mark = marks_[slot];
+        if (mark == stamp_) {
+            scores_[slot] += score;
+        }
+        else if (mark != stamp_ + 1) {
+            mark = stamp_;
+            scores_[slot] = score;
+            touched_.push_back(slot);
+        }
+    }
+
+    // Later Add calls skip an excluded slot, so it never appears in GetTouched
+    void Exclude(DocumentSlot slot) {
+        marks_[slot] = stamp_ + 1;
+    }
+
+    double GetScore(DocumentSlot slot) const {
+        return scores_[slot];
+    }
+
+    const std::vector<DocumentSlot>& GetTouched() const {
+        return touched_;
+    }
+
+private:
+    std::vector<double> scores_;
+    std::vector<uint32_t> marks_;
+    std::vector<DocumentSlot> touched_;
+    uint32_t stamp_ = 0;
+};
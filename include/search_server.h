@@ -1,24 +1,68 @@
 #pragma once
+#include <array>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <string_view>
 #include <vector>
 #include <map>
+#include <memory_resource>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <stdexcept>
 #include <algorithm>
 #include <utility>
 #include <cmath>
+#include <exception>
 #include <execution>
 #include <future>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <type_traits>
 
 #include "string_processing.h"
 #include "document.h"
+#include "document_attributes.h"
+#include "idf_cache.h"
 #include "read_input_functions.h"
-#include "concurrent_map.h"
+#include "posting_list.h"
+#include "query_cache.h"
+#include "score_accumulator.h"
+#include "term_dictionary.h"
+#include "thread_pool.h"
+#include "top_documents.h"
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double ACCURACY = 1e-6;
+// Relative cost of a binary search step over a long posting list, which mostly misses the cache,
+// to a step of a sequential walk; decides how minus terms and status filters are resolved
+const double MINUS_PROBE_STEP_COST = 4.0;
+
+enum class RemovalMode {
+    IMMEDIATE,
+    TOMBSTONE,
+};
+
+enum class RetrievalMode {
+    EXHAUSTIVE,
+    MAX_SCORE,
+};
+
+enum class PostingFormat {
+    PLAIN,
+    COMPRESSED,
+};
+
+// Predicate of the FindTopDocuments overloads that filter by status. Its type is recognized at compile
+// time, so queries that pass it only score the documents with that status when that is cheaper.
+struct DocumentStatusPredicate {
+    DocumentStatus status;
+
+    bool operator()(int, DocumentStatus document_status, int) const {
+        return document_status == status;
+    }
+};
 
 class SearchServer {
 public:
@@ -27,23 +71,44 @@ public:
     explicit SearchServer(StringContainer stop_words);
     explicit SearchServer(const std::string_view stop_words_text);
     explicit SearchServer(const std::string& stop_words_text);
+    SearchServer(SearchServer&& other) = default;
+    SearchServer& operator=(SearchServer&& other);
 
     void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
+    // Tokenizes the batch in parallel and builds its postings in one sort/group pass.
+    // For every input document the result holds the exception AddDocument would have thrown for it,
+    // or nullptr if the document was added; a failed document does not stop the rest of the batch.
+    std::vector<std::exception_ptr> AddDocuments(const std::vector<RawDocument>& documents);
+    template <typename ExecutionPolicy>
+    std::vector<std::exception_ptr> AddDocuments(ExecutionPolicy policy, const std::vector<RawDocument>& documents);
+
     template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
     template <typename ExecutionPolicy, typename DocumentPredicate>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy,  const std::string_view raw_query,
-                                           DocumentPredicate document_predicate) const;
+                                           DocumentPredicate document_predicate,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
     template <typename ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, DocumentStatus status) const;
+    std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, DocumentStatus status,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
 
     std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
     template <typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query) const;
 
+    // Answers a batch of queries on the pool. Queries that parse to the same terms are answered once,
+    // the IDF of every distinct term is resolved once for the batch, and queries with the most postings
+    // to score start first, so that a mixed batch finishes close to its total work over the threads.
+    std::vector<std::vector<Document>> FindTopDocumentsBatch(ThreadPool& pool,
+                                                             const std::vector<std::string_view>& raw_queries,
+                                                             DocumentStatus status = DocumentStatus::ACTUAL,
+                                                             size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
     int GetDocumentCount() const;
 
     std::set<int>::const_iterator begin() const;
@@ -51,9 +116,79 @@ public:
 
     std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
 
+    // Binary snapshot of the whole index. LoadSnapshot replaces the stop words and all documents
+    // of this server and leaves it unchanged if the file cannot be read or fails validation.
+    void SaveSnapshot(const std::string& path) const;
+    void LoadSnapshot(const std::string& path);
+
+    // While frozen, IDF values computed so far stay fixed when documents are added or removed
+    void FreezeStatistics();
+    void UnfreezeStatistics();
+
     void RemoveDocument(int document_id);
     template <typename ExecutionPolicy>
     void RemoveDocument(ExecutionPolicy policy, int document_id);
+    // Unknown ids are skipped. Every posting list that loses documents is rewritten once for the whole batch.
+    void RemoveDocuments(const std::vector<int>& document_ids);
+    template <typename ExecutionPolicy>
+    void RemoveDocuments(ExecutionPolicy policy, const std::vector<int>& document_ids);
+
+    // Ids of documents whose set of words equals that of a document with a smaller id, ascending.
+    // Documents are grouped by a 128-bit signature of their word set, and only documents with equal
+    // signatures are compared word by word.
+    std::vector<int> FindDuplicateDocuments() const;
+    template <typename ExecutionPolicy>
+    std::vector<int> FindDuplicateDocuments(ExecutionPolicy policy) const;
+
+    // Clusters of documents linked by pairs whose word sets have a Jaccard similarity of at least threshold,
+    // each with ids ascending, ordered by their smallest id; documents without similar ones are left out.
+    // A cluster is closed transitively: every member is similar to some other member, but two members may
+    // be less similar than the threshold. Candidate pairs come from locality-sensitive hashing of MinHash
+    // sketches and are then checked exactly. A pair above the threshold is missed if no band puts it into
+    // one bucket, which is unlikely. In a bucket of more than 33 documents, however, each document is only
+    // compared with the 32 that follow it by id, so a similar pair that shares nothing but large
+    // buckets of mixed content is missed on every call.
+    std::vector<std::vector<int>> FindNearDuplicates(double threshold) const;
+    template <typename ExecutionPolicy>
+    std::vector<std::vector<int>> FindNearDuplicates(ExecutionPolicy policy, double threshold) const;
+    // Jaccard similarity of the word sets of two documents, 0 if either is unknown or has no words
+    double ComputeSimilarity(int document_id, int other_document_id) const;
+
+    // RemoveDocument masks the document out of queries at once and leaves its postings to a compaction
+    // pass. In IMMEDIATE mode the pass runs by itself once the postings of removed documents make up
+    // an eighth of the index, so a removal takes amortized time proportional to the document length.
+    // In TOMBSTONE mode it runs only when the index is compacted explicitly.
+    void SetRemovalMode(RemovalMode mode);
+
+    // MAX_SCORE skips documents whose score upper bound can not reach the current top results;
+    // both modes return the same documents
+    void SetRetrievalMode(RetrievalMode mode);
+
+    // COMPRESSED stores postings in bit-packed blocks with 16-bit term frequencies, a fraction of the
+    // plain size; relevances are then computed from the quantized frequencies and may differ slightly
+    void SetPostingFormat(PostingFormat format);
+
+    // Caches the results of FindTopDocuments calls that filter by status, keyed by the parsed query,
+    // the status and the result count. Any change of the corpus invalidates the cached results.
+    void EnableQueryCache(size_t max_memory_bytes);
+    void DisableQueryCache();
+    // All zero while the cache is disabled
+    QueryCache::Stats GetQueryCacheStats() const;
+
+    struct IndexCompaction {
+        uint64_t corpus_version = 0;
+        std::vector<DocumentSlot> slots;
+        std::vector<std::pair<TermId, PostingList>> postings;
+    };
+
+    // PrepareCompaction only reads the index, so it may run on a background thread while
+    // queries are served. ApplyCompaction returns false if the corpus changed in between.
+    template <typename ExecutionPolicy>
+    IndexCompaction PrepareCompaction(ExecutionPolicy policy) const;
+    bool ApplyCompaction(IndexCompaction&& compaction);
+    void CompactIndex();
+    template <typename ExecutionPolicy>
+    void CompactIndex(ExecutionPolicy policy);
 
     std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view, int document_id) const;
     template <typename ExecutionPolicy>
@@ -61,43 +196,118 @@ public:
                                                                             int document_id) const;
 
 private:
-    struct DocumentData {
-        int rating;
-        DocumentStatus status;
+    // Scores its shards with IDF values of the whole corpus
+    friend class ShardedSearchServer;
+
+    static constexpr size_t DOCUMENT_STATUS_COUNT = static_cast<size_t>(DocumentStatus::REMOVED) + 1;
+
+    struct TermFreq {
+        TermId term;
+        double freq;
     };
 
+    using TermFreqs = std::pmr::vector<TermFreq>;
+
     struct QueryWord {
         std::string_view data;
+        TermId term;
         bool is_minus;
         bool is_stop;
     };
 
+    // Words that are absent from the dictionary cannot affect the result and are dropped
     struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
     };
 
-    std::set<std::string, std::less<>> all_words_;
-    std::set<std::string_view> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string_view, double>> word_freqs_used_id_;
-    std::map<int, DocumentData> documents_;
+    TermDictionary dictionary_;
+    std::vector<bool> stop_terms_;
+    std::vector<PostingList> word_to_document_freqs_;
+    // Term lists of the documents are bump-allocated from an arena. The lists of removed documents are not
+    // reused; once they take more than half of the arena, the live lists are copied to a new one.
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> forward_memory_ = std::make_unique<std::pmr::monotonic_buffer_resource>();
+    size_t forward_size_ = 0;
+    size_t released_forward_size_ = 0;
+    std::vector<TermFreqs> word_freqs_used_id_;
+    DocumentAttributes documents_;
+    // Nodes of the id lookup come from a pool that reuses the nodes of removed documents
+    std::unique_ptr<std::pmr::unsynchronized_pool_resource> node_memory_ = std::make_unique<std::pmr::unsynchronized_pool_resource>();
+    std::pmr::unordered_map<int, DocumentSlot> document_slots_{ node_memory_.get() };
     std::set<int> document_ids_;
-
-    bool IsStopWord(const std::string_view word) const;
-    static bool IsValidWord(const std::string_view word);
-    std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view text) const;
-
-    QueryWord ParseQueryWord(const std::string_view text) const;
+    // Slots of the documents of every status, ascending. Removed slots stay until the lists are compacted,
+    // which happens once they outnumber the live ones, so removing a document takes constant time.
+    std::array<std::vector<DocumentSlot>, DOCUMENT_STATUS_COUNT> status_slots_;
+    size_t removed_status_slot_count_ = 0;
+    std::vector<uint32_t> term_document_counts_;
+    std::vector<bool> removed_slots_;
+    std::vector<DocumentSlot> tombstones_;
+    size_t tombstone_posting_count_ = 0;
+    RemovalMode removal_mode_ = RemovalMode::IMMEDIATE;
+    RetrievalMode retrieval_mode_ = RetrievalMode::MAX_SCORE;
+    PostingFormat posting_format_ = PostingFormat::PLAIN;
+    uint64_t corpus_version_ = 0;
+    IdfCache idf_cache_;
+    std::unique_ptr<QueryCache> query_cache_;
+
+    TermId AddTerm(const std::string_view word);
+    void SplitIntoWordsNoStop(const std::string_view text, std::vector<std::string_view>& words) const;
+    std::vector<TermId> SplitIntoTermsNoStop(const std::string_view text);
+    static std::vector<TermFreq> ComputeTermFreqs(std::vector<TermId> terms);
+    void AppendDocument(int document_id, int rating, DocumentStatus status, const std::vector<TermFreq>& word_freqs);
+    void ReleaseTermFreqs(DocumentSlot slot);
+    void ShrinkForwardIndex();
+    void CompactStatusSlots();
+
+    QueryWord ParseQueryWord(const std::string_view text, bool is_valid) const;
     Query ParseQuery(const std::string_view text, bool flag) const;
-
-    double ComputeWordInverseDocumentFreq(const std::string_view word) const;
+    bool ContainsTerm(TermId term, DocumentSlot slot) const;
+    // Minus terms are resolved before plus terms are scored. Documents of a minus term are excluded in the
+    // accumulator, so plus postings skip them, unless its list is long enough that probing it for every
+    // scored document is cheaper; such lists are returned to be checked with ContainsAny.
+    std::vector<const PostingList*> ExcludeMinusDocuments(const Query& query, DocumentSlot first, DocumentSlot last,
+                                                          ScoreAccumulator& accumulator) const;
+    static bool ContainsAny(const std::vector<const PostingList*>& postings, DocumentSlot slot);
+    // Scores only the documents with the status, looking up each of them in the postings of the query.
+    // Returns false without scoring anything if walking the postings is cheaper.
+    bool FindDocumentsWithStatus(const Query& query, const std::vector<double>& inverse_document_freqs,
+                                 DocumentStatus status, DocumentSlot first, DocumentSlot last,
+                                 TopDocuments& top_documents) const;
+
+    double ComputeWordInverseDocumentFreq(TermId term) const;
+    std::vector<double> ComputeInverseDocumentFreqs(const Query& query) const;
     static int ComputeAverageRating(const std::vector<int>& ratings);
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    TopDocuments FindAllDocuments(const Query& query, DocumentPredicate document_predicate,
+                                  size_t max_result_count) const;
     template <typename DocumentPredicate, typename ExecutionPolicy>
-    std::vector<Document> FindAllDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate) const;
+    TopDocuments FindAllDocuments(ExecutionPolicy policy, const Query& query, DocumentPredicate document_predicate,
+                                  size_t max_result_count) const;
+    template <typename DocumentPredicate>
+    void FindDocumentsInSlotRange(const Query& query, const std::vector<double>& inverse_document_freqs,
+                                  DocumentPredicate document_predicate, DocumentSlot first, DocumentSlot last,
+                                  TopDocuments& top_documents) const;
+    template <typename DocumentPredicate>
+    void FindDocumentsInSlotRangeMaxScore(const Query& query, const std::vector<double>& inverse_document_freqs,
+                                          DocumentPredicate document_predicate, DocumentSlot first, DocumentSlot last,
+                                          TopDocuments& top_documents) const;
+
+    static uint64_t MixHash(uint64_t value);
+    static double ComputeSimilarity(const TermFreqs& lhs, const TermFreqs& rhs);
+
+    // Parallel queries split the slot space into ranges scored independently
+    static constexpr size_t MIN_SLOTS_PER_TASK = 1024;
+    static constexpr DocumentSlot MAX_SCORE_WINDOW_SLOTS = 4096;
+    // In IMMEDIATE removal mode the index is compacted once removed documents hold one in this many of its postings
+    static constexpr size_t TOMBSTONE_POSTING_SHARE = 8;
+    // Values in a MinHash sketch, split into bands for locality-sensitive hashing
+    static constexpr size_t MIN_HASH_COUNT = 64;
+    static constexpr double MIN_CANDIDATE_PROBABILITY = 0.95;
+    // Members of a band bucket are compared with this many following members, so a bucket of up to
+    // one more member is compared completely. Larger buckets are not, which keeps the candidate pairs
+    // of a band linear in the document count.
+    static constexpr size_t MAX_BUCKET_NEIGHBORS = 32;
 };
 
 template <typename StringContainer>
@@ -107,47 +317,124 @@ SearchServer::SearchServer(StringContainer stop_words) {
     }
     for (std::string_view word : stop_words) {
         if (!word.empty()) {
-            auto it_word = all_words_.insert(std::string(word));
-            stop_words_.insert(*it_word.first);
+            stop_terms_[AddTerm(word)] = true;
         }
     }
 }
 
+template <typename ExecutionPolicy>
+std::vector<std::exception_ptr> SearchServer::AddDocuments(ExecutionPolicy policy,
+                                                           const std::vector<RawDocument>& documents) {
+    std::vector<std::exception_ptr> errors(documents.size());
+    std::vector<std::vector<std::string_view>> document_words(documents.size());
+    std::vector<size_t> indexes(documents.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(policy, indexes.begin(), indexes.end(), [&](size_t i) {
+        try {
+            SplitIntoWordsNoStop(documents[i].text, document_words[i]);
+        }
+        catch (...) {
+            errors[i] = std::current_exception();
+        }
+        });
+
+    std::unordered_set<int> batch_ids;
+    std::vector<size_t> accepted;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const int document_id = documents[i].id;
+        if (document_id < 0 || document_slots_.count(document_id) > 0 || batch_ids.count(document_id) > 0) {
+            errors[i] = std::make_exception_ptr(std::invalid_argument("Invalid document_id"));
+            continue;
+        }
+        if (!errors[i]) {
+            batch_ids.insert(document_id);
+            accepted.push_back(i);
+        }
+    }
+
+    std::vector<std::vector<TermId>> document_terms(accepted.size());
+    for (size_t k = 0; k < accepted.size(); ++k) {
+        document_terms[k].reserve(document_words[accepted[k]].size());
+        for (const std::string_view word : document_words[accepted[k]]) {
+            document_terms[k].push_back(AddTerm(word));
+        }
+    }
+    std::vector<std::vector<TermFreq>> document_freqs(accepted.size());
+    std::transform(policy, document_terms.begin(), document_terms.end(), document_freqs.begin(),
+        [](std::vector<TermId>& terms) {
+            return ComputeTermFreqs(std::move(terms));
+        });
+
+    struct NewPosting {
+        TermId term;
+        DocumentSlot slot;
+        double freq;
+    };
+    const auto first_slot = static_cast<DocumentSlot>(documents_.size());
+    std::vector<NewPosting> postings;
+    for (size_t k = 0; k < accepted.size(); ++k) {
+        for (const auto [term, freq] : document_freqs[k]) {
+            postings.push_back({ term, static_cast<DocumentSlot>(first_slot + k), freq });
+        }
+    }
+    std::sort(policy, postings.begin(), postings.end(), [](const NewPosting& lhs, const NewPosting& rhs) {
+        return std::tie(lhs.term, lhs.slot) < std::tie(rhs.term, rhs.slot);
+        });
+    std::vector<size_t> group_starts;
+    for (size_t i = 0; i < postings.size(); ++i) {
+        if (i == 0 || postings[i].term != postings[i - 1].term) {
+            group_starts.push_back(i);
+        }
+    }
+    std::for_each(policy, group_starts.begin(), group_starts.end(), [this, &postings](size_t start) {
+        const TermId term = postings[start].term;
+        PostingList& term_postings = word_to_document_freqs_[term];
+        for (size_t i = start; i < postings.size() && postings[i].term == term; ++i) {
+            term_postings.Add(postings[i].slot, postings[i].freq);
+        }
+        });
+
+    for (size_t k = 0; k < accepted.size(); ++k) {
+        const RawDocument& document = documents[accepted[k]];
+        AppendDocument(document.id, ComputeAverageRating(document.ratings), document.status, document_freqs[k]);
+    }
+    if (!accepted.empty()) {
+        ++corpus_version_;
+        idf_cache_.Invalidate();
+    }
+    return errors;
+}
+
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query,
-    DocumentPredicate document_predicate) const {
-    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+    DocumentPredicate document_predicate, size_t max_result_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate, max_result_count);
 }
 
 template <typename ExecutionPolicy, typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, std::string_view raw_query,
-    DocumentPredicate document_predicate) const {
+    DocumentPredicate document_predicate, size_t max_result_count) const {
     const auto query = ParseQuery(raw_query, true);
 
-    auto matched_documents = FindAllDocuments(policy, query, document_predicate);
-
-    sort(policy, matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < ACCURACY) {
-                return lhs.rating > rhs.rating;
-            }
-            else {
-                return lhs.relevance > rhs.relevance;
-            }
-        });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
-    }
-
-    return matched_documents;
+    return FindAllDocuments(policy, query, document_predicate, max_result_count).Extract();
 }
 
 template <typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, const std::string_view raw_query, 
-                                                    DocumentStatus status) const {
-    return FindTopDocuments(policy, raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-        });
+                                                    DocumentStatus status, size_t max_result_count) const {
+    const DocumentStatusPredicate status_predicate{ status };
+    if (!query_cache_) {
+        return FindTopDocuments(policy, raw_query, status_predicate, max_result_count);
+    }
+
+    const auto query = ParseQuery(raw_query, true);
+    const QueryCache::Key key{ query.plus_terms, query.minus_terms, status, max_result_count };
+    if (auto documents = query_cache_->Find(key, corpus_version_)) {
+        return std::move(*documents);
+    }
+    std::vector<Document> documents = FindAllDocuments(policy, query, status_predicate, max_result_count).Extract();
+    query_cache_->Insert(key, documents, corpus_version_);
+    return documents;
 }
 
 template <typename ExecutionPolicy>
@@ -156,75 +443,563 @@ std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy policy, con
 }
 
 template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+TopDocuments SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate,
+                                            size_t max_result_count) const {
+    const std::vector<double> inverse_document_freqs = ComputeInverseDocumentFreqs(query);
+    TopDocuments top_documents(max_result_count);
+    FindDocumentsInSlotRange(query, inverse_document_freqs, document_predicate,
+                             0, static_cast<DocumentSlot>(documents_.size()), top_documents);
+    return top_documents;
+}
+
+template <typename DocumentPredicate, typename ExecutionPolicy>
+TopDocuments SearchServer::FindAllDocuments(ExecutionPolicy policy, const Query& query, 
+                                            DocumentPredicate document_predicate, size_t max_result_count) const {
+
+    if (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
+        return FindAllDocuments(query, document_predicate, max_result_count);
+    }
+
+    const std::vector<double> inverse_document_freqs = ComputeInverseDocumentFreqs(query);
+    const size_t slot_count = documents_.size();
+    const size_t part_count = std::clamp<size_t>(slot_count / MIN_SLOTS_PER_TASK, 1,
+                                                 std::max(1u, std::thread::hardware_concurrency()) * 2);
+    std::vector<TopDocuments> parts(part_count, TopDocuments(max_result_count));
+    std::vector<size_t> part_indexes(part_count);
+    std::iota(part_indexes.begin(), part_indexes.end(), 0);
+    std::for_each(policy, part_indexes.begin(), part_indexes.end(),
+        [&](size_t part) {
+            const auto first = static_cast<DocumentSlot>(slot_count * part / part_count);
+            const auto last = static_cast<DocumentSlot>(slot_count * (part + 1) / part_count);
+            FindDocumentsInSlotRange(query, inverse_document_freqs, document_predicate, first, last, parts[part]);
+        });
+
+    TopDocuments top_documents(max_result_count);
+    for (const TopDocuments& part : parts) {
+        top_documents.Merge(part);
+    }
+    return top_documents;
+}
+
+template <typename DocumentPredicate>
+void SearchServer::FindDocumentsInSlotRange(const Query& query, const std::vector<double>& inverse_document_freqs,
+                                            DocumentPredicate document_predicate, DocumentSlot first, DocumentSlot last,
+                                            TopDocuments& top_documents) const {
+    if constexpr (std::is_same_v<DocumentPredicate, DocumentStatusPredicate>) {
+        if (FindDocumentsWithStatus(query, inverse_document_freqs, document_predicate.status, first, last, top_documents)) {
+            return;
+        }
+    }
+    if (retrieval_mode_ == RetrievalMode::MAX_SCORE) {
+        // Short posting lists are cheaper to score exhaustively than to split into windows
+        size_t posting_count = 0;
+        for (const TermId term : query.plus_terms) {
+            posting_count += word_to_document_freqs_[term].size();
+        }
+        if (posting_count * (last - first) >= MAX_SCORE_WINDOW_SLOTS * documents_.size()) {
+            FindDocumentsInSlotRangeMaxScore(query, inverse_document_freqs, document_predicate, first, last, top_documents);
+            return;
+        }
+    }
+    ScoreAccumulator& accumulator = ScoreAccumulator::ForCurrentThread();
+    accumulator.Reset(last - first);
+    const std::vector<const PostingList*> probed_minus_postings = ExcludeMinusDocuments(query, first, last, accumulator);
+    for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+        const double inverse_document_freq = inverse_document_freqs[i];
+        word_to_document_freqs_[query.plus_terms[i]].ForEachInRange(first, last,
+            [&accumulator, first, inverse_document_freq](DocumentSlot slot, double term_freq) {
+                accumulator.Add(slot - first, term_freq * inverse_document_freq);
+            });
+    }
+
+    // An attribute filter checks the scored documents in blocks instead of one call per document
+    if constexpr (std::is_same_v<DocumentPredicate, AttributeFilter>) {
+        std::vector<DocumentSlot> candidates;
+        for (const DocumentSlot local_slot : accumulator.GetTouched()) {
+            if (!removed_slots_[first + local_slot] && !ContainsAny(probed_minus_postings, first + local_slot)) {
+                candidates.push_back(local_slot);
+            }
+        }
+        candidates.resize(documents_.Filter(document_predicate, first, candidates.data(), candidates.size()));
+        for (const DocumentSlot local_slot : candidates) {
+            const DocumentSlot slot = first + local_slot;
+            top_documents.Push({ documents_.GetId(slot), accumulator.GetScore(local_slot), documents_.GetRating(slot) });
+        }
+        return;
+    }
+    for (const DocumentSlot local_slot : accumulator.GetTouched()) {
+        const DocumentSlot slot = first + local_slot;
+        if (removed_slots_[slot] || ContainsAny(probed_minus_postings, slot)) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        if (document_predicate(documents_.GetId(slot), documents_.GetStatus(slot), documents_.GetRating(slot))) {
+            top_documents.Push({ documents_.GetId(slot), accumulator.GetScore(local_slot), documents_.GetRating(slot) });
+        }
+    }
+}
+
+template <typename DocumentPredicate>
+void SearchServer::FindDocumentsInSlotRangeMaxScore(const Query& query, const std::vector<double>& inverse_document_freqs,
+                                                    DocumentPredicate document_predicate, DocumentSlot first, DocumentSlot last,
+                                                    TopDocuments& top_documents) const {
+    if (top_documents.GetMaxCount() == 0) {
+        return;
+    }
+    struct Cursor {
+        PostingList::RangeReader reader;
+        size_t window_count;
+        double max_score;
+    };
+    const size_t term_count = query.plus_terms.size();
+    std::vector<Cursor> cursors;
+    cursors.reserve(term_count);
+    for (const TermId term : query.plus_terms) {
+        cursors.push_back({ PostingList::RangeReader(word_to_document_freqs_[term], first), 0, 0.0 });
+    }
+    // Term frequency of the slot within the current window of the i-th term, 0 if the term is absent
+    const auto find_term_freq = [&cursors](size_t i, DocumentSlot slot) {
+        return cursors[i].reader.FindTermFreq(slot);
+    };
+
+    ScoreAccumulator& accumulator = ScoreAccumulator::ForCurrentThread();
+    accumulator.Reset(last - first);
+    const std::vector<const PostingList*> probed_minus_postings = ExcludeMinusDocuments(query, first, last, accumulator);
+
+    // A document scoring below the threshold loses to the current worst result even after the
+    // ACCURACY tie rule; the extra margin covers rounding in the upper bound sums
+    double threshold = -std::numeric_limits<double>::infinity();
+    const auto update_threshold = [&] {
+        if (top_documents.IsFull()) {
+            threshold = top_documents.GetWorst().relevance - 2 * ACCURACY;
+        }
+    };
+    update_threshold();
+
+    // The slot range is processed in windows. Within a window, terms are ranked by ascending upper bound;
+    // the lowest ranked (non-essential) terms together can not lift a document into the top, so only
+    // documents containing an essential term are candidates. Essential postings are accumulated term at
+    // a time, and non-essential postings are only looked up for candidates that may still qualify.
+    std::vector<size_t> order(term_count);
+    std::vector<size_t> ranks(term_count);
+    std::vector<double> bound_sums(term_count + 1, 0.0);
+    std::vector<DocumentSlot> candidates;
+    size_t touched_begin = 0;
+    for (DocumentSlot window_first = first; window_first < last;) {
+        const DocumentSlot window_last = window_first + std::min<DocumentSlot>(MAX_SCORE_WINDOW_SLOTS, last - window_first);
+        for (size_t i = 0; i < term_count; ++i) {
+            Cursor& cursor = cursors[i];
+            cursor.reader.Advance(window_last);
+            cursor.window_count = cursor.reader.GetMaxCount();
+            cursor.max_score = std::max(0.0, cursor.reader.GetMaxTermFreq() * inverse_document_freqs[i]);
+        }
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&cursors](size_t lhs, size_t rhs) {
+            return cursors[lhs].max_score < cursors[rhs].max_score;
+            });
+        size_t non_essential_count = 0;
+        for (size_t j = 0; j < term_count; ++j) {
+            ranks[order[j]] = j;
+            bound_sums[j + 1] = bound_sums[j] + cursors[order[j]].max_score;
+            if (bound_sums[j + 1] < threshold) {
+                non_essential_count = j + 1;
+            }
+        }
+        // Looking up non-essential postings per candidate only pays off when they are
+        // the bulk of the window; otherwise the whole window is accumulated
+        size_t non_essential_postings = 0;
+        size_t essential_postings = 0;
+        for (size_t j = 0; j < term_count; ++j) {
+            const Cursor& cursor = cursors[order[j]];
+            (j < non_essential_count ? non_essential_postings : essential_postings) += cursor.window_count;
+        }
+        if (non_essential_postings < essential_postings) {
+            non_essential_count = 0;
+        }
+
+        for (size_t i = 0; i < term_count; ++i) {
+            if (ranks[i] >= non_essential_count) {
+                const double inverse_document_freq = inverse_document_freqs[i];
+                cursors[i].reader.ForEach(
+                    [&accumulator, first, inverse_document_freq](DocumentSlot slot, double term_freq) {
+                        accumulator.Add(slot - first, term_freq * inverse_document_freq);
+                    });
+            }
+        }
+
+        const auto& touched = accumulator.GetTouched();
+        candidates.clear();
+        for (size_t k = touched_begin; k < touched.size(); ++k) {
+            const DocumentSlot local_slot = touched[k];
+            if (removed_slots_[first + local_slot]
+                || accumulator.GetScore(local_slot) + bound_sums[non_essential_count] < threshold) {
+                continue;
+            }
+            if constexpr (std::is_same_v<DocumentPredicate, DocumentStatusPredicate>) {
+                // Saves the lookups of the non-essential terms for documents that are filtered out anyway
+                if (documents_.GetStatus(first + local_slot) != document_predicate.status) {
+                    continue;
+                }
+            }
+            candidates.push_back(local_slot);
+        }
+        touched_begin = touched.size();
+        constexpr bool is_attribute_filter = std::is_same_v<DocumentPredicate, AttributeFilter>;
+        if constexpr (is_attribute_filter) {
+            candidates.resize(documents_.Filter(document_predicate, first, candidates.data(), candidates.size()));
+        }
+        for (const DocumentSlot local_slot : candidates) {
+            const DocumentSlot slot = first + local_slot;
+            // Essential terms are accumulated in query order, so without non-essential terms
+            // the score is already summed exactly as the exhaustive path sums it. Otherwise the
+            // non-essential terms are checked strongest first until the bound drops below the threshold.
+            double relevance = accumulator.GetScore(local_slot);
+            if (non_essential_count > 0) {
+                double upper_bound = relevance + bound_sums[non_essential_count];
+                for (size_t j = non_essential_count; j-- > 0 && upper_bound >= threshold;) {
+                    const size_t i = order[j];
+                    upper_bound += find_term_freq(i, slot) * inverse_document_freqs[i] - cursors[i].max_score;
+                }
+                if (upper_bound < threshold) {
+                    continue;
+                }
+                relevance = 0.0;
+                for (size_t i = 0; i < term_count; ++i) {
+                    if (const double term_freq = find_term_freq(i, slot); term_freq > 0.0) {
+                        relevance += term_freq * inverse_document_freqs[i];
+                    }
+                }
+            }
+            if (ContainsAny(probed_minus_postings, slot)) {
+                continue;
+            }
+            if (is_attribute_filter
+                || document_predicate(documents_.GetId(slot), documents_.GetStatus(slot), documents_.GetRating(slot))) {
+                top_documents.Push({ documents_.GetId(slot), relevance, documents_.GetRating(slot) });
+                update_threshold();
             }
         }
+        window_first = window_last;
     }
+}
 
-    for (std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+template <typename ExecutionPolicy>
+void SearchServer::RemoveDocument(ExecutionPolicy policy, int document_id) {
+    const auto it = document_slots_.find(document_id);
+    if (it == document_slots_.end()) {
+        return;
+    }
+    const DocumentSlot slot = it->second;
+    document_slots_.erase(it);
+    document_ids_.erase(document_id);
+    removed_slots_[slot] = true;
+    if (++removed_status_slot_count_ > document_slots_.size()) {
+        CompactStatusSlots();
+    }
+
+    const auto& word_freqs = word_freqs_used_id_[slot];
+    for (const TermFreq& term_freq : word_freqs) {
+        --term_document_counts_[term_freq.term];
+    }
+    // Erasing the document from its posting lists would take time proportional to their length
+    tombstones_.push_back(slot);
+    tombstone_posting_count_ += word_freqs.size();
+    ++corpus_version_;
+    idf_cache_.Invalidate();
+    if (removal_mode_ == RemovalMode::IMMEDIATE
+        && tombstone_posting_count_ * TOMBSTONE_POSTING_SHARE >= forward_size_ - released_forward_size_) {
+        CompactIndex(policy);
+    }
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::RemoveDocuments(ExecutionPolicy policy, const std::vector<int>& document_ids) {
+    std::vector<DocumentSlot> slots;
+    for (const int document_id : document_ids) {
+        const auto it = document_slots_.find(document_id);
+        if (it == document_slots_.end()) {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+        const DocumentSlot slot = it->second;
+        document_slots_.erase(it);
+        document_ids_.erase(document_id);
+        removed_slots_[slot] = true;
+        for (const TermFreq& term_freq : word_freqs_used_id_[slot]) {
+            --term_document_counts_[term_freq.term];
         }
+        slots.push_back(slot);
     }
+    if (slots.empty()) {
+        return;
+    }
+    CompactStatusSlots();
 
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back(
-            { document_id, relevance, documents_.at(document_id).rating });
+    if (removal_mode_ == RemovalMode::TOMBSTONE) {
+        tombstones_.insert(tombstones_.end(), slots.begin(), slots.end());
+        for (const DocumentSlot slot : slots) {
+            tombstone_posting_count_ += word_freqs_used_id_[slot].size();
+        }
+    }
+    else {
+        std::vector<TermId> terms;
+        for (const DocumentSlot slot : slots) {
+            for (const TermFreq& term_freq : word_freqs_used_id_[slot]) {
+                terms.push_back(term_freq.term);
+            }
+            ReleaseTermFreqs(slot);
+        }
+        std::sort(policy, terms.begin(), terms.end());
+        terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+        std::for_each(policy, terms.begin(), terms.end(), [this](TermId term) {
+            word_to_document_freqs_[term].RemoveIf([this](DocumentSlot slot) {
+                return removed_slots_[slot];
+                });
+            });
+        ShrinkForwardIndex();
     }
-    return matched_documents;
+    ++corpus_version_;
+    idf_cache_.Invalidate();
 }
 
-template <typename DocumentPredicate, typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindAllDocuments(ExecutionPolicy policy, const Query& query, 
-                                                    DocumentPredicate document_predicate) const {
+template <typename ExecutionPolicy>
+std::vector<int> SearchServer::FindDuplicateDocuments(ExecutionPolicy policy) const {
+    struct Signature {
+        uint64_t low;
+        uint64_t high;
+        int document_id;
+        DocumentSlot slot;
+    };
+    std::vector<Signature> signatures;
+    signatures.reserve(document_slots_.size());
+    for (const int document_id : document_ids_) {
+        signatures.push_back({ 0, 0, document_id, document_slots_.at(document_id) });
+    }
+    // Sums of two independent mixes of the term ids do not depend on the order of the terms
+    std::for_each(policy, signatures.begin(), signatures.end(), [this](Signature& signature) {
+        for (const TermFreq& term_freq : word_freqs_used_id_[signature.slot]) {
+            const uint64_t value = MixHash(term_freq.term);
+            signature.low += value;
+            signature.high += MixHash(value);
+        }
+        });
+    std::sort(policy, signatures.begin(), signatures.end(), [](const Signature& lhs, const Signature& rhs) {
+        return std::tie(lhs.low, lhs.high, lhs.document_id) < std::tie(rhs.low, rhs.high, rhs.document_id);
+        });
 
-    if (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
-        return FindAllDocuments(query, document_predicate);
-    }
-
-    ConcurrentMap<int, double> document_to_relevance(word_to_document_freqs_.size());
-    std::for_each(policy, query.plus_words.begin(), query.plus_words.end(),
-        [this, &document_to_relevance, document_predicate](std::string_view word) {
-            if (word_to_document_freqs_.count(std::string(word)) != 0) {
-                const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                for (const auto [document_id, term_freq] : word_to_document_freqs_.at(std::string(word))) {
-                    DocumentData document_data;
-                    document_data = documents_.at(document_id);
-                    if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                        document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                    }
+    const auto has_same_words = [this](DocumentSlot lhs, DocumentSlot rhs) {
+        return std::equal(word_freqs_used_id_[lhs].begin(), word_freqs_used_id_[lhs].end(),
+                          word_freqs_used_id_[rhs].begin(), word_freqs_used_id_[rhs].end(),
+                          [](const TermFreq& lhs, const TermFreq& rhs) {
+                              return lhs.term == rhs.term;
+                          });
+    };
+    std::vector<int> duplicates;
+    std::vector<DocumentSlot> originals;
+    for (size_t first = 0, last = 0; first < signatures.size(); first = last) {
+        while (last < signatures.size() && signatures[last].low == signatures[first].low
+               && signatures[last].high == signatures[first].high) {
+            ++last;
+        }
+        // Within a group of equal signatures, ids ascend, so the first of each word set is kept
+        originals.clear();
+        for (size_t i = first; i < last; ++i) {
+            const DocumentSlot slot = signatures[i].slot;
+            if (std::any_of(originals.begin(), originals.end(), [&](DocumentSlot original) {
+                    return has_same_words(original, slot);
+                })) {
+                duplicates.push_back(signatures[i].document_id);
+            }
+            else {
+                originals.push_back(slot);
+            }
+        }
+    }
+    std::sort(duplicates.begin(), duplicates.end());
+    return duplicates;
+}
+
+template <typename ExecutionPolicy>
+std::vector<std::vector<int>> SearchServer::FindNearDuplicates(ExecutionPolicy policy, double threshold) const {
+    if (!(threshold > 0.0 && threshold <= 1.0)) {
+        throw std::invalid_argument("Similarity threshold must be in (0, 1]");
+    }
+    // Documents by ascending id; those without words are similar to nothing
+    std::vector<DocumentSlot> slots;
+    for (const int document_id : document_ids_) {
+        const DocumentSlot slot = document_slots_.at(document_id);
+        if (!word_freqs_used_id_[slot].empty()) {
+            slots.push_back(slot);
+        }
+    }
+    const size_t document_count = slots.size();
+
+    // The k-th hash of a term is h1 + k * h2, derived from two mixes of its id
+    std::vector<uint32_t> sketches(document_count * MIN_HASH_COUNT);
+    std::vector<size_t> indexes(document_count);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(policy, indexes.begin(), indexes.end(), [&](size_t i) {
+        uint32_t* sketch = sketches.data() + i * MIN_HASH_COUNT;
+        std::fill(sketch, sketch + MIN_HASH_COUNT, std::numeric_limits<uint32_t>::max());
+        for (const TermFreq& term_freq : word_freqs_used_id_[slots[i]]) {
+            const uint64_t first_hash = MixHash(term_freq.term);
+            const uint64_t second_hash = MixHash(first_hash) | 1;
+            for (size_t k = 0; k < MIN_HASH_COUNT; ++k) {
+                sketch[k] = std::min(sketch[k], static_cast<uint32_t>((first_hash + k * second_hash) >> 32));
+            }
+        }
+        });
+
+    // Two documents become candidates if all values of some band are equal, which happens with probability
+    // 1 - (1 - s^rows)^bands for similarity s. Higher bands give fewer false candidates; the highest is
+    // taken that still makes a pair at the threshold a candidate with MIN_CANDIDATE_PROBABILITY.
+    size_t band_rows = 1;
+    for (size_t rows = 2; rows <= MIN_HASH_COUNT; rows *= 2) {
+        const double band_count = static_cast<double>(MIN_HASH_COUNT / rows);
+        if (1.0 - std::pow(1.0 - std::pow(threshold, rows), band_count) >= MIN_CANDIDATE_PROBABILITY) {
+            band_rows = rows;
+        }
+    }
+    // Large buckets mostly hold many copies of one text; comparing each member with a window of the
+    // following ones still links them, without the quadratic number of pairs
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> band_candidates(MIN_HASH_COUNT / band_rows);
+    std::vector<size_t> bands(band_candidates.size());
+    std::iota(bands.begin(), bands.end(), 0);
+    std::for_each(policy, bands.begin(), bands.end(), [&](size_t band) {
+        std::vector<std::pair<uint64_t, uint32_t>> buckets(document_count);
+        for (size_t i = 0; i < document_count; ++i) {
+            const uint32_t* values = sketches.data() + i * MIN_HASH_COUNT + band * band_rows;
+            uint64_t hash = 0;
+            for (size_t row = 0; row < band_rows; ++row) {
+                hash = MixHash(hash ^ values[row]);
+            }
+            buckets[i] = { hash, static_cast<uint32_t>(i) };
+        }
+        std::sort(buckets.begin(), buckets.end());
+        auto& candidates = band_candidates[band];
+        for (size_t first = 0, last = 0; first < document_count; first = last) {
+            while (last < document_count && buckets[last].first == buckets[first].first) {
+                ++last;
+            }
+            for (size_t i = first; i < last; ++i) {
+                for (size_t k = i + 1; k < std::min(last, i + 1 + MAX_BUCKET_NEIGHBORS); ++k) {
+                    candidates.emplace_back(buckets[i].second, buckets[k].second);
                 }
             }
+        }
         });
-    auto document_to_relevance_ = document_to_relevance.BuildOrdinaryMap();
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(std::string(word)) == 0) {
+    std::vector<std::pair<uint32_t, uint32_t>> candidates;
+    for (const auto& band : band_candidates) {
+        candidates.insert(candidates.end(), band.begin(), band.end());
+    }
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>>().swap(band_candidates);
+    std::sort(policy, candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    std::vector<char> is_similar(candidates.size());
+    std::transform(policy, candidates.begin(), candidates.end(), is_similar.begin(),
+        [&](const std::pair<uint32_t, uint32_t>& candidate) {
+            return static_cast<char>(ComputeSimilarity(word_freqs_used_id_[slots[candidate.first]],
+                                                       word_freqs_used_id_[slots[candidate.second]]) >= threshold);
+        });
+
+    // Similar pairs are joined into clusters rooted at their smallest index, that is, the smallest id
+    std::vector<uint32_t> parents(document_count);
+    std::iota(parents.begin(), parents.end(), 0);
+    const auto find_root = [&parents](uint32_t i) {
+        while (parents[i] != i) {
+            parents[i] = parents[parents[i]];
+            i = parents[i];
+        }
+        return i;
+    };
+    for (size_t k = 0; k < candidates.size(); ++k) {
+        if (is_similar[k]) {
+            const uint32_t lhs_root = find_root(candidates[k].first);
+            const uint32_t rhs_root = find_root(candidates[k].second);
+            parents[std::max(lhs_root, rhs_root)] = std::min(lhs_root, rhs_root);
+        }
+    }
+    std::vector<std::vector<int>> clusters;
+    std::vector<size_t> cluster_indexes(document_count, std::numeric_limits<size_t>::max());
+    for (uint32_t i = 0; i < document_count; ++i) {
+        const uint32_t root = find_root(i);
+        if (root == i) {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(std::string(word))) {
-            document_to_relevance_.erase(document_id);
+        if (cluster_indexes[root] == std::numeric_limits<size_t>::max()) {
+            cluster_indexes[root] = clusters.size();
+            clusters.push_back({ documents_.GetId(slots[root]) });
         }
+        clusters[cluster_indexes[root]].push_back(documents_.GetId(slots[i]));
     }
+    std::sort(clusters.begin(), clusters.end());
+    return clusters;
+}
 
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance_) {
-        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+template <typename ExecutionPolicy>
+SearchServer::IndexCompaction SearchServer::PrepareCompaction(ExecutionPolicy policy) const {
+    IndexCompaction compaction;
+    compaction.corpus_version = corpus_version_;
+    compaction.slots = tombstones_;
+
+    std::vector<TermId> terms;
+    for (const DocumentSlot slot : tombstones_) {
+        for (const TermFreq& term_freq : word_freqs_used_id_[slot]) {
+            terms.push_back(term_freq.term);
+        }
     }
-    return matched_documents;
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+    compaction.postings.resize(terms.size());
+    std::transform(policy, terms.begin(), terms.end(), compaction.postings.begin(), [this](TermId term) {
+        PostingList postings = word_to_document_freqs_[term];
+        postings.RemoveIf([this](DocumentSlot slot) {
+            return removed_slots_[slot];
+            });
+        return std::pair{ term, std::move(postings) };
+        });
+    return compaction;
 }
 
+template <typename ExecutionPolicy>
+void SearchServer::CompactIndex(ExecutionPolicy policy) {
+    ApplyCompaction(PrepareCompaction(policy));
+}
 
+template <typename ExecutionPolicy>
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(ExecutionPolicy policy,
+                                                   const std::string_view raw_query, int document_id) const {
+
+    if (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
+        return MatchDocument(raw_query, document_id);
+    }
+
+    const auto it = document_slots_.find(document_id);
+    if (it == document_slots_.end()) {
+        return { {}, {} };
+    }
+    const DocumentSlot slot = it->second;
+    const Query query = ParseQuery(raw_query, false);
+
+    if (std::any_of(policy,
+        query.minus_terms.begin(), query.minus_terms.end(), [&](TermId term) {
+            return ContainsTerm(term, slot);
+        })) {
+        return { std::vector<std::string_view>{}, documents_.GetStatus(slot) };
+    }
+
+    std::vector<TermId> matched_terms(query.plus_terms.size());
+    auto it_copy = std::copy_if(policy,
+        query.plus_terms.begin(), query.plus_terms.end(), matched_terms.begin(), [&](TermId term) {
+            return ContainsTerm(term, slot);
+        });
+
+    std::vector<std::string_view> matched_words;
+    matched_words.reserve(it_copy - matched_terms.begin());
+    for (auto it = matched_terms.begin(); it != it_copy; ++it) {
+        matched_words.push_back(dictionary_.GetWord(*it));
+    }
+    sort(matched_words.begin(), matched_words.end());
+    matched_words.erase(unique(matched_words.begin(), matched_words.end()), matched_words.end());
+    return { matched_words, documents_.GetStatus(slot) };
+}
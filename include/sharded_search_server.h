@@ -0,0 +1,92 @@
+#pragma once
+
+#include <deque>
+#include <exception>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "thread_pool.h"
+#include "top_documents.h"
+
+// Splits documents over several SearchServer shards by a hash of the document id. Queries run on all
+// shards in parallel and their top documents are merged; every shard scores with IDF values computed
+// from the document counts of the whole corpus, so results match those of a single server. Batches of
+// added or removed documents are split by shard, and the shards are updated in parallel.
+class ShardedSearchServer {
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(size_t shard_count, const StringContainer& stop_words);
+    ShardedSearchServer(size_t shard_count, const std::string_view stop_words_text);
+    ShardedSearchServer(size_t shard_count, const std::string& stop_words_text);
+
+    void AddDocument(int document_id, const std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    // Same contract as SearchServer::AddDocuments
+    std::vector<std::exception_ptr> AddDocuments(const std::vector<RawDocument>& documents);
+
+    void RemoveDocument(int document_id);
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query, DocumentStatus status,
+                                           size_t max_result_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const std::string_view raw_query) const;
+
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view raw_query,
+                                                                            int document_id) const;
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+    int GetDocumentCount() const;
+    size_t GetShardCount() const;
+
+private:
+    std::deque<SearchServer> shards_;
+
+    size_t GetShardIndex(int document_id) const;
+    SearchServer& GetShard(int document_id);
+    const SearchServer& GetShard(int document_id) const;
+    // Corpus-wide IDF of every plus term of every shard's query, in the order of the query terms
+    std::vector<std::vector<double>> ComputeInverseDocumentFreqs(const std::vector<SearchServer::Query>& queries) const;
+};
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const StringContainer& stop_words) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count must be positive");
+    }
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words);
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query,
+    DocumentPredicate document_predicate, size_t max_result_count) const {
+    std::vector<SearchServer::Query> queries;
+    queries.reserve(shards_.size());
+    for (const SearchServer& shard : shards_) {
+        queries.push_back(shard.ParseQuery(raw_query, true));
+    }
+    const std::vector<std::vector<double>> inverse_document_freqs = ComputeInverseDocumentFreqs(queries);
+
+    std::vector<TopDocuments> parts(shards_.size(), TopDocuments(max_result_count));
+    ThreadPool::Shared().Run(shards_.size(), [&](size_t i) {
+        const SearchServer& shard = shards_[i];
+        shard.FindDocumentsInSlotRange(queries[i], inverse_document_freqs[i], document_predicate,
+                                       0, static_cast<DocumentSlot>(shard.documents_.size()), parts[i]);
+        });
+
+    TopDocuments top_documents(max_result_count);
+    for (const TopDocuments& part : parts) {
+        top_documents.Merge(part);
+    }
+    return top_documents.Extract();
+}
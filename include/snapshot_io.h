@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Snapshot file layout: a SnapshotHeader followed by the payload. The payload is a sequence of
+// 64-bit values and arrays; an array is its element count followed by the raw elements, zero-padded
+// to a multiple of 8 bytes. Every array therefore starts 8-byte aligned within the file.
+const char SNAPSHOT_MAGIC[8] = { 'S', 'R', 'V', 'S', 'N', 'A', 'P', '\0' };
+const uint32_t SNAPSHOT_FORMAT_VERSION = 2;
+const uint32_t SNAPSHOT_BYTE_ORDER_MARK = 0x01020304;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t format_version;
+    uint32_t byte_order_mark;
+    uint64_t payload_size;
+    uint64_t checksum;
+};
+
+// Throws std::runtime_error unless the header describes a snapshot this build can read
+void ValidateSnapshotHeader(const SnapshotHeader& header, const std::string& source);
+
+// FNV-1a over 64-bit words; the result does not depend on how the input is split into chunks
+class SnapshotChecksum {
+public:
+    void Update(const void* data, size_t size);
+    uint64_t Get() const;
+
+private:
+    uint64_t hash_ = 14695981039346656037ull;
+    uint64_t pending_ = 0;
+    size_t pending_size_ = 0;
+    uint64_t total_size_ = 0;
+
+    void Mix(uint64_t word) {
+        hash_ = (hash_ ^ word) * 1099511628211ull;
+    }
+};
+
+// Writes to a temporary file next to the target, which replaces the target only in Finish,
+// so a failed save leaves the previous snapshot intact
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(const std::string& path);
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+    ~SnapshotWriter();
+
+    void WriteValue(uint64_t value);
+
+    template <typename T>
+    void WriteArray(const std::vector<T>& values) {
+        BeginArray(values.size());
+        WriteElements(values.data(), values.size());
+        EndArray();
+    }
+
+    // An array may also be written piecewise: BeginArray, any number of WriteElements, EndArray
+    void BeginArray(uint64_t count);
+    template <typename T>
+    void WriteElements(const T* data, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        Write(data, count * sizeof(T));
+    }
+    void EndArray();
+
+    void Finish();
+
+private:
+    std::string path_;
+    std::string temp_path_;
+    std::ofstream out_;
+    bool is_finished_ = false;
+    SnapshotChecksum checksum_;
+    uint64_t payload_size_ = 0;
+    uint64_t array_start_ = 0;
+
+    void Write(const void* data, size_t size);
+};
+
+class SnapshotReader {
+public:
+    explicit SnapshotReader(const std::string& path);
+
+    uint64_t ReadValue();
+
+    template <typename T>
+    std::vector<T> ReadArray() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const uint64_t count = ReadValue();
+        if (count > remaining_ / sizeof(T)) {
+            throw std::runtime_error("Snapshot is truncated or corrupted");
+        }
+        std::vector<T> values(count);
+        Read(values.data(), count * sizeof(T));
+        SkipPadding(count * sizeof(T));
+        return values;
+    }
+
+    // Throws if the payload was not consumed completely or its checksum does not match
+    void Finish();
+
+private:
+    std::ifstream in_;
+    SnapshotChecksum checksum_;
+    SnapshotHeader header_;
+    uint64_t remaining_ = 0;
+
+    void Read(void* data, size_t size);
+    void SkipPadding(uint64_t size);
+};
+
+// Read-only view of a snapshot array that stays inside the snapshot buffer
+template <typename T>
+class SnapshotArrayView {
+public:
+    SnapshotArrayView() = default;
+    SnapshotArrayView(const T* data, size_t size) : data_(data), size_(size) {}
+
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    const T& operator[](size_t index) const { return data_[index]; }
+    const T& front() const { return data_[0]; }
+    const T& back() const { return data_[size_ - 1]; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Parses a snapshot that is already in memory (e.g. a mapped file). Arrays are returned as views
+// into the buffer, so the buffer must outlive them; the checksum is only verified on request.
+class SnapshotMemoryReader {
+public:
+    SnapshotMemoryReader(const char* data, size_t size, const std::string& source);
+
+    uint64_t ReadValue();
+
+    template <typename T>
+    SnapshotArrayView<T> ReadArray() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        static_assert(alignof(T) <= 8);
+        const uint64_t count = ReadValue();
+        if (count > remaining_ / sizeof(T)) {
+            throw std::runtime_error("Snapshot is truncated or corrupted");
+        }
+        const auto* data = reinterpret_cast<const T*>(position_);
+        const uint64_t size = std::min<uint64_t>((count * sizeof(T) + 7) / 8 * 8, remaining_);
+        position_ += size;
+        remaining_ -= size;
+        return { data, count };
+    }
+
+    // Throws if the payload was not consumed completely
+    void Finish() const;
+    bool VerifyChecksum() const;
+
+private:
+    const char* payload_;
+    const char* position_;
+    SnapshotHeader header_;
+    uint64_t remaining_ = 0;
+};
@@ -1,8 +1,27 @@
 #pragma once
 
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <string_view>
 
 std::vector<std::string_view> SplitIntoWordsView(std::string_view text);
-std::vector<std::string> SplitIntoWords(std::string& text);
\ No newline at end of file
+
+// Splits text on spaces into words, replacing the contents of the caller's buffer; adjacent spaces
+// yield empty words. The words are checked for control characters in the same pass: the result is
+// the index of the first invalid word, or words.size() if all of them are valid.
+// Uses AVX2 or SSE2 when the CPU supports them.
+size_t SplitIntoWordsView(std::string_view text, std::vector<std::string_view>& words);
+std::vector<std::string> SplitIntoWords(const std::string& text);
+
+// A word is invalid if it contains control characters (codes 0 to 31)
+bool IsValidWord(std::string_view word);
+
+struct QueryWordText {
+    std::string_view word;
+    bool is_minus = false;
+};
+
+// Strips the minus prefix of a query word; throws std::invalid_argument for an empty or malformed word.
+// is_valid tells whether the word is free of control characters, as reported by SplitIntoWordsView.
+QueryWordText ParseQueryWordText(std::string_view text, bool is_valid);
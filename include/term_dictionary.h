@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using TermId = uint32_t;
+
+const TermId INVALID_TERM_ID = std::numeric_limits<TermId>::max();
+
+// Interns words into dense ids using an open-addressing (linear probing) hash table.
+// Words are copied back to back into large character chunks, which are never moved or freed
+// before the dictionary, so returned string_views stay valid for the lifetime of the dictionary.
+class TermDictionary {
+public:
+    TermDictionary();
+
+    TermId Add(std::string_view word);
+    TermId Find(std::string_view word) const;
+
+    std::string_view GetWord(TermId term) const {
+        return words_[term];
+    }
+
+    size_t size() const {
+        return words_.size();
+    }
+
+private:
+    struct Slot {
+        uint32_t hash = 0;
+        TermId term = INVALID_TERM_ID;
+    };
+
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    std::vector<std::string_view> words_;
+    std::vector<Slot> slots_;
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    char* chunk_free_ = nullptr;
+    size_t chunk_free_size_ = 0;
+
+    std::string_view StoreWord(std::string_view word);
+    static uint32_t Hash(std::string_view word);
+    size_t FindSlot(std::string_view word, uint32_t hash) const;
+    void Grow();
+};
@@ -5,10 +5,23 @@
 #include <vector>
 #include <set>
 #include <cassert>
+#include <atomic>
+#include <thread>
 #include <stdexcept>
 #include <numeric>
+#include <random>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <cstring>
 
 #include "search_server.h"
+#include "concurrent_search_server.h"
+#include "mapped_search_server.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "sharded_search_server.h"
+#include "snapshot_io.h"
 
 using namespace std;
 
@@ -75,6 +88,18 @@ void TestSearchDocementsByStatus();
 int CountMatchWordInAllDocuments(vector<string>content, string word_query);
 double TfIdf(vector<string>content, string word_query, double idf);
 void TestRelevanceSearchDocuments();
+void TestRemoveFromCompressedPostings();
+void AssertEqualDocuments(const vector<Document>& lhs, const vector<Document>& rhs, const string& hint);
+void TestMaxScoreMatchesExhaustive();
+string ReadFileBytes(const string& path);
+void WriteFileBytes(const string& path, const string& bytes);
+void TestSnapshotRoundTrip();
+void TestMoveAssignment();
+void TestShardedMatchesSingleServer();
+void TestConcurrentReadersSeeWholeUpdates();
+void TestAddDocumentsReportsErrorsPerDocument();
+void TestFindDuplicateDocuments();
+void TestProcessQueriesJoined();
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer();
 
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent pool of worker threads with a task queue per worker. Each worker takes tasks from the
+// front of its own queue, and once it is empty steals from the back of the others, so a few slow
+// tasks do not hold up the rest of a batch. A thread waiting for its batch runs queued tasks as well.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    // Process-wide pool with a worker per hardware thread but one, which is left to the calling thread
+    static ThreadPool& Shared();
+
+    // Calls task(i) for every i in [0, count) and returns once all calls are done, rethrowing an
+    // exception thrown by any of them. Indexes are dealt to the worker queues round-robin and each
+    // queue is run from the front, so the costliest tasks should have the smallest indexes.
+    template <typename Task>
+    void Run(size_t count, Task task);
+
+private:
+    struct Job {
+        void (*run)(void* task, size_t index);
+        void* task;
+        std::atomic<size_t> remaining;
+        std::mutex mutex;
+        std::condition_variable done;
+        bool is_done = false;
+        std::exception_ptr error;
+    };
+
+    struct WorkItem {
+        Job* job;
+        size_t index;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<WorkItem> items;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> next_queue_{ 0 };
+    std::atomic<size_t> queued_count_{ 0 };
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool is_stopping_ = false;
+
+    void Submit(Job& job, size_t count);
+    void Wait(Job& job);
+    void WorkerLoop(size_t queue_index);
+    bool RunQueuedTask(size_t queue_index);
+    static void Execute(const WorkItem& item);
+};
+
+template <typename Task>
+void ThreadPool::Run(size_t count, Task task) {
+    if (count == 0) {
+        return;
+    }
+    Job job;
+    job.run = [](void* task, size_t index) {
+        (*static_cast<Task*>(task))(index);
+    };
+    job.task = &task;
+    job.remaining.store(count, std::memory_order_relaxed);
+    Submit(job, count);
+    Wait(job);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "document.h"
+
+const double ACCURACY = 1e-6;
+
+// Result order: relevance descending, documents with relevance closer than ACCURACY
+// are ordered by rating, then by id so that ties are broken deterministically
+inline bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) >= ACCURACY) {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating) {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+// Keeps the best max_count documents seen so far in a heap whose front is the worst of them
+class TopDocuments {
+public:
+    explicit TopDocuments(size_t max_count) : max_count_(max_count) {
+        // The count comes from the caller and may be huge; a larger heap grows as documents arrive
+        heap_.reserve(std::min(max_count, MAX_RESERVED_COUNT));
+    }
+
+    void Push(const Document& document) {
+        if (heap_.size() < max_count_) {
+            heap_.push_back(document);
+            std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        }
+        else if (max_count_ > 0 && IsMoreRelevant(document, heap_.front())) {
+            std::pop_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+            heap_.back() = document;
+            std::push_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        }
+    }
+
+    void Merge(const TopDocuments& other) {
+        for (const Document& document : other.heap_) {
+            Push(document);
+        }
+    }
+
+    bool IsFull() const {
+        return heap_.size() >= max_count_;
+    }
+
+    const Document& GetWorst() const {
+        return heap_.front();
+    }
+
+    size_t GetMaxCount() const {
+        return max_count_;
+    }
+
+    std::vector<Document> Extract() {
+        std::sort_heap(heap_.begin(), heap_.end(), IsMoreRelevant);
+        return std::move(heap_);
+    }
+
+private:
+    static constexpr size_t MAX_RESERVED_COUNT = 64;
+
+    size_t max_count_;
+    std::vector<Document> heap_;
+};
@@ -0,0 +1,103 @@
+#include "bit_packing.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const size_t LANE_COUNT = 4;
+const size_t LANE_VALUES = PACKED_BLOCK_VALUES / LANE_COUNT;
+
+uint32_t LowBitsMask(unsigned bit_width) {
+    return bit_width >= 32 ? ~uint32_t{0} : (uint32_t{1} << bit_width) - 1;
+}
+
+}  // namespace
+
+unsigned BitWidth(uint32_t value) {
+    unsigned bit_width = 0;
+    for (; value != 0; value >>= 1) {
+        ++bit_width;
+    }
+    return bit_width;
+}
+
+void PackBlock(const uint32_t* values, unsigned bit_width, uint32_t* out) {
+    const size_t word_count = PackedBlockWords(bit_width);
+    for (size_t i = 0; i < word_count; ++i) {
+        out[i] = 0;
+    }
+    // A block of zero gaps takes no words at all
+    if (bit_width == 0) {
+        return;
+    }
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        for (size_t i = 0; i < LANE_VALUES; ++i) {
+            const uint32_t value = values[i * LANE_COUNT + lane];
+            const size_t bit = i * bit_width;
+            const size_t word = bit / 32;
+            const size_t shift = bit % 32;
+            out[word * LANE_COUNT + lane] |= value << shift;
+            if (shift + bit_width > 32) {
+                out[(word + 1) * LANE_COUNT + lane] |= value >> (32 - shift);
+            }
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+void UnpackBlockGaps(const uint32_t* in, unsigned bit_width, uint32_t base, uint32_t* values) {
+    const __m128i mask = _mm_set1_epi32(static_cast<int>(LowBitsMask(bit_width)));
+    const __m128i step = _mm_set1_epi32(static_cast<int>(LANE_COUNT));
+    __m128i indexes = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(base)), _mm_setr_epi32(0, 1, 2, 3));
+    __m128i running_sum = _mm_setzero_si128();
+    for (size_t i = 0; i < LANE_VALUES; ++i) {
+        __m128i gaps = _mm_setzero_si128();
+        if (bit_width > 0) {
+            const size_t bit = i * bit_width;
+            const size_t word = bit / 32;
+            const auto shift = static_cast<int>(bit % 32);
+            const auto* words = reinterpret_cast<const __m128i*>(in + word * LANE_COUNT);
+            gaps = _mm_srl_epi32(_mm_loadu_si128(words), _mm_cvtsi32_si128(shift));
+            if (shift + bit_width > 32) {
+                gaps = _mm_or_si128(gaps, _mm_sll_epi32(_mm_loadu_si128(words + 1), _mm_cvtsi32_si128(32 - shift)));
+            }
+            gaps = _mm_and_si128(gaps, mask);
+        }
+        // Prefix sum within the register, then carry the total of the previous registers
+        gaps = _mm_add_epi32(gaps, _mm_slli_si128(gaps, 4));
+        gaps = _mm_add_epi32(gaps, _mm_slli_si128(gaps, 8));
+        running_sum = _mm_add_epi32(gaps, running_sum);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(values + i * LANE_COUNT), _mm_add_epi32(running_sum, indexes));
+        running_sum = _mm_shuffle_epi32(running_sum, _MM_SHUFFLE(3, 3, 3, 3));
+        indexes = _mm_add_epi32(indexes, step);
+    }
+}
+
+#else
+
+void UnpackBlockGaps(const uint32_t* in, unsigned bit_width, uint32_t base, uint32_t* values) {
+    const uint32_t mask = LowBitsMask(bit_width);
+    uint32_t running_sum = 0;
+    for (size_t i = 0; i < LANE_VALUES; ++i) {
+        const size_t bit = i * bit_width;
+        const size_t word = bit / 32;
+        const size_t shift = bit % 32;
+        for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+            uint32_t gap = 0;
+            if (bit_width > 0) {
+                gap = in[word * LANE_COUNT + lane] >> shift;
+                if (shift + bit_width > 32) {
+                    gap |= in[(word + 1) * LANE_COUNT + lane] << (32 - shift);
+                }
+            }
+            running_sum += gap & mask;
+            const size_t index = i * LANE_COUNT + lane;
+            values[index] = base + static_cast<uint32_t>(index) + running_sum;
+        }
+    }
+}
+
+#endif
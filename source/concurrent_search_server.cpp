@@ -0,0 +1,88 @@
+#include "concurrent_search_server.h"
+
+#include <functional>
+#include <thread>
+
+ConcurrentSearchServer::ConcurrentSearchServer(const std::string_view stop_words_text)
+    : ConcurrentSearchServer(SplitIntoWordsView(stop_words_text)) {}
+
+ConcurrentSearchServer::ConcurrentSearchServer(const std::string& stop_words_text)
+    : ConcurrentSearchServer(SplitIntoWordsView(stop_words_text)) {}
+
+void ConcurrentSearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status,
+                                         const std::vector<int>& ratings) {
+    Update([&](SearchServer& server) {
+        server.AddDocument(document_id, document, status, ratings);
+        });
+}
+
+std::vector<std::exception_ptr> ConcurrentSearchServer::AddDocuments(const std::vector<RawDocument>& documents) {
+    std::vector<std::exception_ptr> errors;
+    Update([&](SearchServer& server) {
+        errors = server.AddDocuments(documents);
+        });
+    return errors;
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+    Update([document_id](SearchServer& server) {
+        server.RemoveDocument(document_id);
+        });
+}
+
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status,
+                                                               size_t max_result_count) const {
+    return Read([&](const SearchServer& server) {
+        return server.FindTopDocuments(raw_query, status, max_result_count);
+        });
+}
+
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(const std::string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+    return Read([](const SearchServer& server) {
+        return server.GetDocumentCount();
+        });
+}
+
+size_t ConcurrentSearchServer::GetReaderStripe() {
+    static thread_local const size_t stripe = std::hash<std::thread::id>{}(std::this_thread::get_id()) % READER_STRIPE_COUNT;
+    return stripe;
+}
+
+// The writer stores the new index and then reads the counters of the old copy, while a reader
+// increments a counter and then reads the index again; with sequentially consistent operations
+// on both sides either the writer sees the reader or the reader sees the new index and backs off
+void ConcurrentSearchServer::Publish(size_t index) {
+    const size_t old_index = published_index_.exchange(index);
+    const ReaderCounter& old_readers = readers_[old_index];
+    for (const ReaderStripe& stripe : old_readers) {
+        while (stripe.count.load() > 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+ConcurrentSearchServer::ReadLock::ReadLock(const ConcurrentSearchServer& server)
+    : server_(server) {
+    const size_t stripe = GetReaderStripe();
+    while (true) {
+        index_ = server_.published_index_.load();
+        reader_count_ = &server_.readers_[index_][stripe].count;
+        reader_count_->fetch_add(1);
+        if (server_.published_index_.load() == index_) {
+            break;
+        }
+        reader_count_->fetch_sub(1);
+    }
+}
+
+ConcurrentSearchServer::ReadLock::~ReadLock() {
+    reader_count_->fetch_sub(1, std::memory_order_release);
+}
+
+const SearchServer& ConcurrentSearchServer::ReadLock::GetServer() const {
+    return server_.copies_[index_];
+}
@@ -0,0 +1,62 @@
+#include "document_attributes.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+void DocumentAttributes::Append(int document_id, int rating, DocumentStatus status) {
+    ids_.push_back(document_id);
+    ratings_.push_back(rating);
+    statuses_.push_back(static_cast<uint8_t>(status));
+}
+
+void DocumentAttributes::Reserve(size_t count) {
+    ids_.reserve(count);
+    ratings_.reserve(count);
+    statuses_.reserve(count);
+}
+
+size_t DocumentAttributes::Filter(const AttributeFilter& filter, DocumentSlot first, DocumentSlot* local_slots,
+                                  size_t count) const {
+    size_t kept = 0;
+    size_t i = 0;
+#if defined(__x86_64__) || defined(_M_X64)
+    // SSE2 has no integer division, so other divisors are checked one document at a time
+    if ((filter.id_divisor & (filter.id_divisor - 1)) == 0) {
+        const __m128i min_rating = _mm_set1_epi32(filter.min_rating);
+        const __m128i max_rating = _mm_set1_epi32(filter.max_rating);
+        const __m128i id_mask = _mm_set1_epi32(static_cast<int>(filter.id_divisor - 1));
+        const __m128i id_remainder = _mm_set1_epi32(static_cast<int>(filter.id_remainder));
+        for (; i + 4 <= count; i += 4) {
+            // The status is looked up in the mask while the attributes are gathered
+            alignas(16) int32_t ids[4];
+            alignas(16) int32_t ratings[4];
+            alignas(16) int32_t statuses[4];
+            for (size_t k = 0; k < 4; ++k) {
+                const DocumentSlot slot = first + local_slots[i + k];
+                ids[k] = ids_[slot];
+                ratings[k] = ratings_[slot];
+                statuses[k] = -static_cast<int32_t>(filter.status_mask >> statuses_[slot] & 1);
+            }
+            const __m128i rating = _mm_load_si128(reinterpret_cast<const __m128i*>(ratings));
+            const __m128i id = _mm_load_si128(reinterpret_cast<const __m128i*>(ids));
+            const __m128i rejected = _mm_or_si128(_mm_cmplt_epi32(rating, min_rating), _mm_cmpgt_epi32(rating, max_rating));
+            const __m128i accepted = _mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(statuses)),
+                                                   _mm_cmpeq_epi32(_mm_and_si128(id, id_mask), id_remainder));
+            const int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(rejected, accepted)));
+            // Every slot is written at or before its own position, so the block is compacted in place
+            for (size_t k = 0; k < 4; ++k) {
+                local_slots[kept] = local_slots[i + k];
+                kept += mask >> k & 1;
+            }
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        const DocumentSlot slot = first + local_slots[i];
+        if (filter(ids_[slot], GetStatus(slot), ratings_[slot])) {
+            local_slots[kept++] = local_slots[i];
+        }
+    }
+    return kept;
+}
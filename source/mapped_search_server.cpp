@@ -0,0 +1,163 @@
+#include "mapped_search_server.h"
+
+MappedSearchServer::MappedSearchServer(const std::string& path) : file_(path) {
+    SnapshotMemoryReader reader(file_.data(), file_.size(), path);
+    term_count_ = reader.ReadValue();
+    term_offsets_ = reader.ReadArray<uint64_t>();
+    term_chars_ = reader.ReadArray<char>();
+    stop_flags_ = reader.ReadArray<uint8_t>();
+    sorted_terms_ = reader.ReadArray<TermId>();
+    document_count_ = reader.ReadValue();
+    ids_ = reader.ReadArray<int>();
+    ratings_ = reader.ReadArray<int>();
+    statuses_ = reader.ReadArray<uint8_t>();
+    slots_by_id_ = reader.ReadArray<DocumentSlot>();
+    posting_offsets_ = reader.ReadArray<uint64_t>();
+    posting_slots_ = reader.ReadArray<DocumentSlot>();
+    posting_freqs_ = reader.ReadArray<double>();
+    forward_offsets_ = reader.ReadArray<uint64_t>();
+    forward_terms_ = reader.ReadArray<TermId>();
+    forward_freqs_ = reader.ReadArray<double>();
+    reader.Finish();
+
+    // Only the section sizes and bounds are checked here, so that opening does not read the index;
+    // offsets, slots and terms are range checked where queries read them
+    CheckContents(term_count_ < INVALID_TERM_ID && stop_flags_.size() == term_count_ && sorted_terms_.size() == term_count_);
+    const auto check_offsets = [](const SnapshotArrayView<uint64_t>& offsets, uint64_t count, uint64_t total) {
+        CheckContents(offsets.size() == count + 1 && offsets.front() == 0 && offsets.back() == total);
+    };
+    check_offsets(term_offsets_, term_count_, term_chars_.size());
+    CheckContents(document_count_ < std::numeric_limits<DocumentSlot>::max());
+    CheckContents(ids_.size() == document_count_ && ratings_.size() == document_count_);
+    CheckContents(statuses_.size() == document_count_ && slots_by_id_.size() == document_count_);
+    check_offsets(posting_offsets_, term_count_, posting_slots_.size());
+    CheckContents(posting_freqs_.size() == posting_slots_.size());
+    check_offsets(forward_offsets_, document_count_, forward_terms_.size());
+    CheckContents(forward_freqs_.size() == forward_terms_.size());
+}
+
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                           size_t max_result_count) const {
+    return FindTopDocuments(raw_query, DocumentStatusPredicate{ status }, max_result_count);
+}
+
+std::vector<Document> MappedSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> MappedSearchServer::MatchDocument(std::string_view raw_query,
+                                                                                           int document_id) const {
+    const std::optional<DocumentSlot> slot = FindSlot(document_id);
+    if (!slot) {
+        throw std::out_of_range("out_of_range ");
+    }
+    const auto status = static_cast<DocumentStatus>(statuses_[*slot]);
+    const Query query = ParseQuery(raw_query);
+
+    for (const TermId term : query.minus_terms) {
+        if (ContainsTerm(term, *slot)) {
+            return { std::vector<std::string_view>{}, status };
+        }
+    }
+    std::vector<std::string_view> matched_words;
+    for (const TermId term : query.plus_terms) {
+        if (ContainsTerm(term, *slot)) {
+            matched_words.push_back(GetWord(term));
+        }
+    }
+    std::sort(matched_words.begin(), matched_words.end());
+    return { matched_words, status };
+}
+
+int MappedSearchServer::GetDocumentCount() const {
+    return static_cast<int>(document_count_);
+}
+
+std::map<std::string_view, double> MappedSearchServer::GetWordFrequencies(int document_id) const {
+    std::map<std::string_view, double> word_freqs;
+    if (const std::optional<DocumentSlot> slot = FindSlot(document_id)) {
+        CheckContents(forward_offsets_[*slot] <= forward_offsets_[*slot + 1]
+                      && forward_offsets_[*slot + 1] <= forward_terms_.size());
+        for (uint64_t i = forward_offsets_[*slot]; i < forward_offsets_[*slot + 1]; ++i) {
+            word_freqs.emplace(GetWord(forward_terms_[i]), forward_freqs_[i]);
+        }
+    }
+    return word_freqs;
+}
+
+bool MappedSearchServer::VerifyChecksum() const {
+    return SnapshotMemoryReader(file_.data(), file_.size(), "").VerifyChecksum();
+}
+
+void MappedSearchServer::CheckContents(bool condition) {
+    if (!condition) {
+        throw std::runtime_error("Snapshot contents are inconsistent");
+    }
+}
+
+std::string_view MappedSearchServer::GetWord(TermId term) const {
+    CheckContents(term < term_count_ && term_offsets_[term] <= term_offsets_[term + 1]
+                  && term_offsets_[term + 1] <= term_chars_.size());
+    return { term_chars_.begin() + term_offsets_[term], term_offsets_[term + 1] - term_offsets_[term] };
+}
+
+TermId MappedSearchServer::FindTerm(std::string_view word) const {
+    const auto it = std::lower_bound(sorted_terms_.begin(), sorted_terms_.end(), word, [this](TermId term, std::string_view value) {
+        return GetWord(term) < value;
+        });
+    return it != sorted_terms_.end() && GetWord(*it) == word ? *it : INVALID_TERM_ID;
+}
+
+std::optional<DocumentSlot> MappedSearchServer::FindSlot(int document_id) const {
+    const auto it = std::lower_bound(slots_by_id_.begin(), slots_by_id_.end(), document_id, [this](DocumentSlot slot, int id) {
+        CheckContents(slot < document_count_);
+        return ids_[slot] < id;
+        });
+    if (it == slots_by_id_.end()) {
+        return std::nullopt;
+    }
+    CheckContents(*it < document_count_);
+    if (ids_[*it] != document_id) {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+std::pair<uint64_t, uint64_t> MappedSearchServer::GetPostingRange(TermId term) const {
+    CheckContents(posting_offsets_[term] <= posting_offsets_[term + 1] && posting_offsets_[term + 1] <= posting_slots_.size());
+    return { posting_offsets_[term], posting_offsets_[term + 1] };
+}
+
+bool MappedSearchServer::ContainsTerm(TermId term, DocumentSlot slot) const {
+    const auto [begin, end] = GetPostingRange(term);
+    return std::binary_search(posting_slots_.begin() + begin, posting_slots_.begin() + end, slot);
+}
+
+double MappedSearchServer::ComputeWordInverseDocumentFreq(TermId term) const {
+    const auto [begin, end] = GetPostingRange(term);
+    return log(GetDocumentCount() * 1.0 / (end - begin));
+}
+
+MappedSearchServer::Query MappedSearchServer::ParseQuery(std::string_view text) const {
+    static thread_local std::vector<std::string_view> words;
+    const size_t invalid_word = SplitIntoWordsView(text, words);
+    Query result;
+    for (size_t i = 0; i < words.size(); ++i) {
+        const auto [query_word, is_minus] = ParseQueryWordText(words[i], i != invalid_word);
+        const TermId term = FindTerm(query_word);
+        if (term == INVALID_TERM_ID || stop_flags_[term]) {
+            continue;
+        }
+        if (is_minus) {
+            result.minus_terms.push_back(term);
+        }
+        else {
+            result.plus_terms.push_back(term);
+        }
+    }
+    std::sort(result.minus_terms.begin(), result.minus_terms.end());
+    result.minus_terms.erase(std::unique(result.minus_terms.begin(), result.minus_terms.end()), result.minus_terms.end());
+    std::sort(result.plus_terms.begin(), result.plus_terms.end());
+    result.plus_terms.erase(std::unique(result.plus_terms.begin(), result.plus_terms.end()), result.plus_terms.end());
+    return result;
+}
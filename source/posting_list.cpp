@@ -0,0 +1,260 @@
+#include "posting_list.h"
+
+#include <cmath>
+
+#include "bit_packing.h"
+
+static_assert(PACKED_BLOCK_VALUES == 128, "compressed posting blocks are packed as a whole");
+
+void PostingList::Add(DocumentSlot slot, double term_freq) {
+    if (!blocks_.empty() && slot <= blocks_.back().last_slot) {
+        // Documents are added in slot order, so this only happens for out-of-order input
+        UnpackBlocks();
+    }
+    if (slots_.empty() || slots_.back() < slot) {
+        slots_.push_back(slot);
+        term_freqs_.push_back(term_freq);
+        if ((slots_.size() - 1) % BLOCK_SIZE == 0) {
+            block_max_term_freqs_.push_back(term_freq);
+        }
+        else {
+            block_max_term_freqs_.back() = std::max(block_max_term_freqs_.back(), term_freq);
+        }
+    }
+    else {
+        const auto it = std::lower_bound(slots_.begin(), slots_.end(), slot);
+        const auto pos = it - slots_.begin();
+        if (it != slots_.end() && *it == slot) {
+            term_freqs_[pos] += term_freq;
+            block_max_term_freqs_[pos / BLOCK_SIZE] = std::max(block_max_term_freqs_[pos / BLOCK_SIZE], term_freqs_[pos]);
+        }
+        else {
+            slots_.insert(it, slot);
+            term_freqs_.insert(term_freqs_.begin() + pos, term_freq);
+            UpdateBlockMaxima(pos);
+        }
+    }
+    if (compressed_ && slots_.size() >= COMPRESSED_BLOCK_SIZE) {
+        PackPlainPostings();
+    }
+}
+
+bool PostingList::Contains(DocumentSlot slot) const {
+    const size_t block = FindBlock(slot);
+    if (block < blocks_.size()) {
+        if (slot < blocks_[block].first_slot) {
+            return false;
+        }
+        DocumentSlot slots[COMPRESSED_BLOCK_SIZE];
+        const size_t count = DecodeBlockSlots(block, slots);
+        return std::binary_search(slots, slots + count, slot);
+    }
+    return std::binary_search(slots_.begin(), slots_.end(), slot);
+}
+
+double PostingList::FindTermFreq(DocumentSlot slot) const {
+    const size_t block = FindBlock(slot);
+    if (block < blocks_.size()) {
+        const CompressedBlock& compressed_block = blocks_[block];
+        if (slot < compressed_block.first_slot) {
+            return 0.0;
+        }
+        DocumentSlot slots[COMPRESSED_BLOCK_SIZE];
+        const size_t count = DecodeBlockSlots(block, slots);
+        const size_t pos = std::lower_bound(slots, slots + count, slot) - slots;
+        if (pos == count || slots[pos] != slot) {
+            return 0.0;
+        }
+        const uint16_t term_freq = quantized_term_freqs_[compressed_block.term_freqs_offset + pos];
+        return compressed_block.max_term_freq * (term_freq / MAX_QUANTIZED_TERM_FREQ);
+    }
+    const auto it = std::lower_bound(slots_.begin(), slots_.end(), slot);
+    return it != slots_.end() && *it == slot ? term_freqs_[it - slots_.begin()] : 0.0;
+}
+
+void PostingList::Compress() {
+    compressed_ = true;
+    PackPlainPostings();
+}
+
+void PostingList::Decompress() {
+    compressed_ = false;
+    UnpackBlocks();
+}
+
+void PostingList::UpdateBlockMaxima(size_t pos) {
+    const size_t first_block = pos / BLOCK_SIZE;
+    block_max_term_freqs_.resize((term_freqs_.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+    for (size_t block = first_block; block < block_max_term_freqs_.size(); ++block) {
+        const auto first = term_freqs_.begin() + block * BLOCK_SIZE;
+        const auto last = term_freqs_.begin() + std::min(term_freqs_.size(), (block + 1) * BLOCK_SIZE);
+        block_max_term_freqs_[block] = *std::max_element(first, last);
+    }
+}
+
+size_t PostingList::FindBlock(DocumentSlot slot) const {
+    return std::partition_point(blocks_.begin(), blocks_.end(), [slot](const CompressedBlock& block) {
+        return block.last_slot < slot;
+        }) - blocks_.begin();
+}
+
+size_t PostingList::DecodeBlock(size_t block, DocumentSlot* slots, double* term_freqs) const {
+    const size_t count = DecodeBlockSlots(block, slots);
+    const CompressedBlock& compressed_block = blocks_[block];
+    const uint16_t* quantized = quantized_term_freqs_.data() + compressed_block.term_freqs_offset;
+    for (size_t i = 0; i < count; ++i) {
+        term_freqs[i] = compressed_block.max_term_freq * (quantized[i] / MAX_QUANTIZED_TERM_FREQ);
+    }
+    return count;
+}
+
+size_t PostingList::DecodeBlockSlots(size_t block, DocumentSlot* slots) const {
+    const CompressedBlock& compressed_block = blocks_[block];
+    UnpackBlockGaps(packed_slots_.data() + compressed_block.slots_offset, compressed_block.bit_width,
+                    compressed_block.first_slot, slots);
+    return compressed_block.count;
+}
+
+void PostingList::AppendBlock(const DocumentSlot* slots, const uint16_t* term_freqs, size_t count, double max_term_freq,
+                              std::vector<CompressedBlock>& blocks, std::vector<uint32_t>& packed_slots,
+                              std::vector<uint16_t>& quantized_term_freqs) {
+    uint32_t gaps[COMPRESSED_BLOCK_SIZE] = {};
+    uint32_t max_gap = 0;
+    for (size_t i = 1; i < count; ++i) {
+        gaps[i] = slots[i] - slots[i - 1] - 1;
+        max_gap = std::max(max_gap, gaps[i]);
+    }
+    const unsigned bit_width = BitWidth(max_gap);
+    CompressedBlock block;
+    block.first_slot = slots[0];
+    block.last_slot = slots[count - 1];
+    block.slots_offset = static_cast<uint32_t>(packed_slots.size());
+    block.term_freqs_offset = static_cast<uint32_t>(quantized_term_freqs.size());
+    block.max_term_freq = max_term_freq;
+    block.bit_width = static_cast<uint8_t>(bit_width);
+    block.count = static_cast<uint8_t>(count);
+    blocks.push_back(block);
+    packed_slots.resize(packed_slots.size() + PackedBlockWords(bit_width));
+    PackBlock(gaps, bit_width, packed_slots.data() + block.slots_offset);
+    quantized_term_freqs.insert(quantized_term_freqs.end(), term_freqs, term_freqs + count);
+}
+
+void PostingList::PackPlainPostings() {
+    const size_t packed_count = slots_.size() / COMPRESSED_BLOCK_SIZE * COMPRESSED_BLOCK_SIZE;
+    if (packed_count == 0) {
+        return;
+    }
+    uint16_t quantized[COMPRESSED_BLOCK_SIZE];
+    for (size_t first = 0; first < packed_count; first += COMPRESSED_BLOCK_SIZE) {
+        const double* term_freqs = term_freqs_.data() + first;
+        const double max_term_freq = *std::max_element(term_freqs, term_freqs + COMPRESSED_BLOCK_SIZE);
+        for (size_t i = 0; i < COMPRESSED_BLOCK_SIZE; ++i) {
+            // Every posting keeps a nonzero weight, however small relative to the block maximum
+            const double scaled = std::round(term_freqs[i] / max_term_freq * MAX_QUANTIZED_TERM_FREQ);
+            quantized[i] = static_cast<uint16_t>(std::clamp(scaled, 1.0, MAX_QUANTIZED_TERM_FREQ));
+        }
+        AppendBlock(slots_.data() + first, quantized, COMPRESSED_BLOCK_SIZE, max_term_freq,
+                    blocks_, packed_slots_, quantized_term_freqs_);
+    }
+    slots_.erase(slots_.begin(), slots_.begin() + packed_count);
+    term_freqs_.erase(term_freqs_.begin(), term_freqs_.begin() + packed_count);
+    compressed_size_ += packed_count;
+    UpdateBlockMaxima(0);
+}
+
+void PostingList::UnpackBlocks() {
+    if (blocks_.empty()) {
+        return;
+    }
+    std::vector<DocumentSlot> slots(compressed_size_);
+    std::vector<double> term_freqs(compressed_size_);
+    size_t pos = 0;
+    for (size_t block = 0; block < blocks_.size(); ++block) {
+        DocumentSlot block_slots[COMPRESSED_BLOCK_SIZE];
+        double block_term_freqs[COMPRESSED_BLOCK_SIZE];
+        const size_t count = DecodeBlock(block, block_slots, block_term_freqs);
+        std::copy(block_slots, block_slots + count, slots.begin() + pos);
+        std::copy(block_term_freqs, block_term_freqs + count, term_freqs.begin() + pos);
+        pos += count;
+    }
+    slots.insert(slots.end(), slots_.begin(), slots_.end());
+    term_freqs.insert(term_freqs.end(), term_freqs_.begin(), term_freqs_.end());
+    slots_ = std::move(slots);
+    term_freqs_ = std::move(term_freqs);
+    blocks_.clear();
+    packed_slots_.clear();
+    quantized_term_freqs_.clear();
+    compressed_size_ = 0;
+    UpdateBlockMaxima(0);
+}
+
+PostingList::RangeReader::RangeReader(const PostingList& postings, DocumentSlot first)
+    : postings_(&postings)
+    , first_(first)
+    , last_(first) {
+    first_block_ = last_block_ = postings.FindBlock(first);
+    const auto& slots = postings.slots_;
+    first_pos_ = last_pos_ = std::lower_bound(slots.begin(), slots.end(), first) - slots.begin();
+}
+
+void PostingList::RangeReader::Advance(DocumentSlot last) {
+    const auto& blocks = postings_->blocks_;
+    const auto& slots = postings_->slots_;
+    first_ = last_;
+    last_ = last;
+    while (first_block_ < blocks.size() && blocks[first_block_].last_slot < first_) {
+        ++first_block_;
+    }
+    last_block_ = std::max(last_block_, first_block_);
+    while (last_block_ < blocks.size() && blocks[last_block_].first_slot < last_) {
+        ++last_block_;
+    }
+    first_pos_ = last_pos_;
+    last_pos_ = std::lower_bound(slots.begin() + first_pos_, slots.end(), last_) - slots.begin();
+    is_decoded_ = false;
+}
+
+double PostingList::RangeReader::GetMaxTermFreq() const {
+    double result = 0.0;
+    for (size_t block = first_block_; block < last_block_; ++block) {
+        result = std::max(result, postings_->blocks_[block].max_term_freq);
+    }
+    if (first_pos_ < last_pos_) {
+        for (size_t block = first_pos_ / BLOCK_SIZE; block <= (last_pos_ - 1) / BLOCK_SIZE; ++block) {
+            result = std::max(result, postings_->block_max_term_freqs_[block]);
+        }
+    }
+    return result;
+}
+
+size_t PostingList::RangeReader::GetMaxCount() const {
+    size_t result = last_pos_ - first_pos_;
+    for (size_t block = first_block_; block < last_block_; ++block) {
+        result += postings_->blocks_[block].count;
+    }
+    return result;
+}
+
+double PostingList::RangeReader::FindTermFreq(DocumentSlot slot) {
+    if (first_block_ < last_block_ && slot <= postings_->blocks_[last_block_ - 1].last_slot) {
+        if (!is_decoded_) {
+            const size_t capacity = (last_block_ - first_block_) * COMPRESSED_BLOCK_SIZE;
+            if (decoded_slots_.size() < capacity) {
+                decoded_slots_.resize(capacity);
+                decoded_term_freqs_.resize(capacity);
+            }
+            decoded_count_ = 0;
+            for (size_t block = first_block_; block < last_block_; ++block) {
+                decoded_count_ += postings_->DecodeBlock(block, decoded_slots_.data() + decoded_count_,
+                                                         decoded_term_freqs_.data() + decoded_count_);
+            }
+            is_decoded_ = true;
+        }
+        const auto last = decoded_slots_.begin() + decoded_count_;
+        const auto it = std::lower_bound(decoded_slots_.begin(), last, slot);
+        return it != last && *it == slot ? decoded_term_freqs_[it - decoded_slots_.begin()] : 0.0;
+    }
+    const auto& slots = postings_->slots_;
+    const auto it = std::lower_bound(slots.begin() + first_pos_, slots.begin() + last_pos_, slot);
+    return it != slots.begin() + last_pos_ && *it == slot ? postings_->term_freqs_[it - slots.begin()] : 0.0;
+}
@@ -4,14 +4,8 @@ std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries)
 {
-    std::vector<std::vector<Document>> result(queries.size());
-
-    transform(std::execution::par, queries.begin(), queries.end(), result.begin(),
-        [&search_server](const std::string& query) {
-            return search_server.FindTopDocuments(query);
-        });
-    return result;
-
+    const std::vector<std::string_view> raw_queries(queries.begin(), queries.end());
+    return search_server.FindTopDocumentsBatch(ThreadPool::Shared(), raw_queries);
 }
 
 std::vector<Document> ProcessQueriesJoined(
@@ -19,8 +13,8 @@ std::vector<Document> ProcessQueriesJoined(
     const std::vector<std::string>& queries)
 {
     std::vector<Document> result;
-    for (const auto& docs : ProcessQueries(search_server, queries)) {
-        result.insert(result.end(), docs.begin(), docs.end());
-    }
+    ProcessQueriesJoined(search_server, queries, [&result](const Document& document) {
+        result.push_back(document);
+        });
     return result;
-}
\ No newline at end of file
+}
@@ -0,0 +1,142 @@
+#include "query_cache.h"
+
+#include <iterator>
+
+namespace {
+
+void CombineHash(size_t& seed, uint64_t value) {
+    // 64-bit finalizer of MurmurHash3, so that nearby term ids spread over the whole range
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    seed ^= static_cast<size_t>(value) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+}  // namespace
+
+size_t QueryCache::KeyHash::operator()(const Key& key) const {
+    size_t seed = key.plus_terms.size();
+    for (const TermId term : key.plus_terms) {
+        CombineHash(seed, term);
+    }
+    CombineHash(seed, key.minus_terms.size());
+    for (const TermId term : key.minus_terms) {
+        CombineHash(seed, term);
+    }
+    CombineHash(seed, static_cast<uint64_t>(key.status));
+    CombineHash(seed, key.max_result_count);
+    return seed;
+}
+
+QueryCache::QueryCache(size_t max_memory_bytes)
+    : max_shard_memory_(max_memory_bytes / SHARD_COUNT) {
+}
+
+std::optional<std::vector<Document>> QueryCache::Find(const Key& key, uint64_t version) {
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+    const auto it = shard.entries.find(key);
+    if (it == shard.entries.end() || it->second.version != version) {
+        if (it != shard.entries.end()) {
+            Erase(shard, it);
+        }
+        ++shard.misses;
+        return std::nullopt;
+    }
+    ++shard.hits;
+    Protect(shard, it->second);
+    return it->second.documents;
+}
+
+void QueryCache::Insert(const Key& key, const std::vector<Document>& documents, uint64_t version) {
+    const size_t memory_usage = EstimateMemoryUsage(key, documents);
+    if (memory_usage > max_shard_memory_) {
+        return;
+    }
+    Shard& shard = GetShard(key);
+    std::lock_guard guard(shard.mutex);
+    if (const auto it = shard.entries.find(key); it != shard.entries.end()) {
+        Erase(shard, it);
+    }
+    const auto it = shard.entries.emplace(key, Entry{ documents, version, memory_usage, false, {} }).first;
+    shard.probation.push_front(&it->first);
+    it->second.position = shard.probation.begin();
+    shard.memory_usage += memory_usage;
+
+    // The new entry is the front of the probation segment; it fits on its own, so the loop stops
+    // before reaching it
+    while (shard.memory_usage > max_shard_memory_) {
+        LruList& victims = shard.probation.size() > 1 || shard.protected_entries.empty()
+            ? shard.probation : shard.protected_entries;
+        Erase(shard, shard.entries.find(*victims.back()));
+        ++shard.evictions;
+    }
+}
+
+void QueryCache::Clear() {
+    for (Shard& shard : shards_) {
+        std::lock_guard guard(shard.mutex);
+        shard.entries.clear();
+        shard.probation.clear();
+        shard.protected_entries.clear();
+        shard.memory_usage = 0;
+        shard.protected_memory_usage = 0;
+    }
+}
+
+QueryCache::Stats QueryCache::GetStats() const {
+    Stats stats;
+    for (const Shard& shard : shards_) {
+        std::lock_guard guard(shard.mutex);
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.evictions += shard.evictions;
+        stats.entry_count += shard.entries.size();
+        stats.memory_usage += shard.memory_usage;
+    }
+    return stats;
+}
+
+QueryCache::Shard& QueryCache::GetShard(const Key& key) {
+    return shards_[KeyHash{}(key) % SHARD_COUNT];
+}
+
+size_t QueryCache::EstimateMemoryUsage(const Key& key, const std::vector<Document>& documents) {
+    // Hash map and list nodes are counted as a few pointers each
+    return sizeof(Key) + sizeof(Entry) + 6 * sizeof(void*)
+        + (key.plus_terms.size() + key.minus_terms.size()) * sizeof(TermId)
+        + documents.size() * sizeof(Document);
+}
+
+void QueryCache::Erase(Shard& shard, EntryMap::iterator it) {
+    Entry& entry = it->second;
+    if (entry.is_protected) {
+        shard.protected_entries.erase(entry.position);
+        shard.protected_memory_usage -= entry.memory_usage;
+    }
+    else {
+        shard.probation.erase(entry.position);
+    }
+    shard.memory_usage -= entry.memory_usage;
+    shard.entries.erase(it);
+}
+
+void QueryCache::Protect(Shard& shard, Entry& entry) {
+    if (entry.is_protected) {
+        shard.protected_entries.splice(shard.protected_entries.begin(), shard.protected_entries, entry.position);
+        return;
+    }
+    shard.protected_entries.splice(shard.protected_entries.begin(), shard.probation, entry.position);
+    entry.is_protected = true;
+    shard.protected_memory_usage += entry.memory_usage;
+
+    // The least recently used protected entries go back to probation, where they are evicted first
+    const auto max_protected_memory = static_cast<size_t>(max_shard_memory_ * PROTECTED_SHARE);
+    while (shard.protected_memory_usage > max_protected_memory && shard.protected_entries.size() > 1) {
+        const auto last = std::prev(shard.protected_entries.end());
+        Entry& demoted = shard.entries.find(**last)->second;
+        shard.probation.splice(shard.probation.begin(), shard.protected_entries, last);
+        demoted.is_protected = false;
+        shard.protected_memory_usage -= demoted.memory_usage;
+    }
+}
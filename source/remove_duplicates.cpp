@@ -3,27 +3,30 @@
 using namespace std;
 
 void RemoveDuplicates(SearchServer& search_server) {
-
-    std::set<int> duplicates_documents;
-    std::set<std::set<std::string_view, std::less<>>> documents;
-    std::set<std::string_view, std::less<>> words_in_documents;
-    
-    for (const int document_id : search_server) {
-        const std::map<std::string_view, double> word_freqs = search_server.GetWordFrequencies(document_id);
-        transform(word_freqs.begin(), word_freqs.end(), inserter(words_in_documents, words_in_documents.begin()),
-            [](const std::pair<std::string_view, double> word) {
-                return word.first;
-            });
-        if (documents.count(words_in_documents) == 0) {
-            documents.insert(words_in_documents);
-        }
-        else {
-            duplicates_documents.insert(document_id);
-        }
+    const std::vector<int> duplicates_documents = search_server.FindDuplicateDocuments(std::execution::par);
+    for (const int document_id : duplicates_documents) {
+        std::cout << "Found duplicate document id " << document_id << "\n";
     }
+    search_server.RemoveDocuments(std::execution::par, duplicates_documents);
+}
 
-    for (int document_id : duplicates_documents) {
-        std::cout << "Found duplicate document id " + document_id << "\n";
-        search_server.RemoveDocument(document_id);
+void RemoveNearDuplicates(SearchServer& search_server, double threshold) {
+    std::vector<int> duplicates_documents;
+    std::vector<int> kept_documents;
+    for (const std::vector<int>& cluster : search_server.FindNearDuplicates(std::execution::par, threshold)) {
+        // Clusters are closed transitively, so every member is checked against the documents kept so far
+        kept_documents.clear();
+        for (const int document_id : cluster) {
+            const auto kept = std::find_if(kept_documents.begin(), kept_documents.end(), [&](int kept_id) {
+                return search_server.ComputeSimilarity(kept_id, document_id) >= threshold;
+                });
+            if (kept == kept_documents.end()) {
+                kept_documents.push_back(document_id);
+                continue;
+            }
+            std::cout << "Found near duplicate document id " << document_id << " of " << *kept << "\n";
+            duplicates_documents.push_back(document_id);
+        }
     }
-}
\ No newline at end of file
+    search_server.RemoveDocuments(std::execution::par, duplicates_documents);
+}
@@ -1,33 +1,93 @@
 #include "request_queue.h"
 
+#include <algorithm>
+
 RequestQueue::RequestQueue(const SearchServer& search_server) :search_server_(search_server)
 {
 }
 
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    std::vector<Document> documents_ = search_server_.FindTopDocuments(raw_query, status);
-    AddEmptyRequest(documents_);
-    requests_.push_back({ documents_, raw_query });
-    DeleteEmptyRequest();
-    return documents_;
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Document> documents = search_server_.FindTopDocuments(raw_query, status);
+    AddRecord(start, documents.size());
+    return documents;
 }
+
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
-    std::vector<Document> documents_ = search_server_.FindTopDocuments(raw_query);
-    AddEmptyRequest(documents_);
-    requests_.push_back({ documents_, raw_query });
-    DeleteEmptyRequest();
-    return documents_;
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
+}
 
+int RequestQueue::GetNoResultRequests() const {
+    const std::vector<RecordData> records = ReadRecords();
+    return static_cast<int>(std::count_if(records.begin(), records.end(), [](const RecordData& record) {
+        return record.result_count == 0;
+        }));
 }
-void RequestQueue::AddEmptyRequest(std::vector<Document>& documents_) {
-    if (documents_.size() == 0) {
-        ++empty_requests_;
+
+RequestQueue::Stats RequestQueue::GetStats() const {
+    std::vector<RecordData> records = ReadRecords();
+    Stats stats;
+    stats.request_count = records.size();
+    if (records.empty()) {
+        return stats;
+    }
+    stats.no_result_count = std::count_if(records.begin(), records.end(), [](const RecordData& record) {
+        return record.result_count == 0;
+        });
+    stats.zero_hit_rate = static_cast<double>(stats.no_result_count) / records.size();
+
+    const auto [first, last] = std::minmax_element(records.begin(), records.end(),
+        [](const RecordData& lhs, const RecordData& rhs) {
+            return lhs.timestamp < rhs.timestamp;
+        });
+    const std::chrono::duration<double> span = std::chrono::nanoseconds(last->timestamp - first->timestamp);
+    if (span.count() > 0) {
+        stats.queries_per_second = (records.size() - 1) / span.count();
     }
+
+    std::vector<int64_t> latencies(records.size());
+    std::transform(records.begin(), records.end(), latencies.begin(), [](const RecordData& record) {
+        return record.latency;
+        });
+    const auto percentile = [&latencies](size_t percent) {
+        const auto it = latencies.begin() + (latencies.size() - 1) * percent / 100;
+        std::nth_element(latencies.begin(), it, latencies.end());
+        return std::chrono::nanoseconds(*it);
+    };
+    stats.p50_latency = percentile(50);
+    stats.p99_latency = percentile(99);
+    return stats;
 }
 
-void RequestQueue::DeleteEmptyRequest() {
-    if (requests_.size() > min_in_day_) {
-        --empty_requests_;
-        requests_.pop_front();
+void RequestQueue::AddRecord(std::chrono::steady_clock::time_point start, size_t result_count) {
+    const auto now = std::chrono::steady_clock::now();
+    const uint64_t request = request_count_.fetch_add(1, std::memory_order_relaxed);
+    Record& record = records_[request % WINDOW_SIZE];
+    record.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    record.timestamp.store(std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count(),
+                           std::memory_order_relaxed);
+    record.latency.store(std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count(),
+                         std::memory_order_relaxed);
+    record.result_count.store(static_cast<uint32_t>(result_count), std::memory_order_relaxed);
+    record.sequence.store(request + 1, std::memory_order_release);
+}
+
+std::vector<RequestQueue::RecordData> RequestQueue::ReadRecords() const {
+    std::vector<RecordData> records;
+    records.reserve(WINDOW_SIZE);
+    for (const Record& record : records_) {
+        const uint64_t sequence = record.sequence.load(std::memory_order_acquire);
+        if (sequence == 0) {
+            continue;
+        }
+        const RecordData data{ record.timestamp.load(std::memory_order_relaxed),
+                               record.latency.load(std::memory_order_relaxed),
+                               record.result_count.load(std::memory_order_relaxed) };
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (record.sequence.load(std::memory_order_relaxed) == sequence) {
+            records.push_back(data);
+        }
     }
-}
\ No newline at end of file
+    return records;
+}
@@ -0,0 +1,22 @@
+#include "score_accumulator.h"
+
+#include <algorithm>
+#include <limits>
+
+ScoreAccumulator& ScoreAccumulator::ForCurrentThread() {
+    static thread_local ScoreAccumulator accumulator;
+    return accumulator;
+}
+
+void ScoreAccumulator::Reset(size_t slot_count) {
+    if (marks_.size() < slot_count) {
+        marks_.resize(slot_count, 0);
+        scores_.resize(slot_count, 0.0);
+    }
+    touched_.clear();
+    if (stamp_ > std::numeric_limits<uint32_t>::max() - 4) {
+        std::fill(marks_.begin(), marks_.end(), 0);
+        stamp_ = 0;
+    }
+    stamp_ += 2;
+}
@@ -1,4 +1,5 @@
 #include "search_server.h"
+#include "snapshot_io.h"
 
 SearchServer::SearchServer(const std::string_view stop_words_text)
     : SearchServer(SplitIntoWordsView(stop_words_text)) {}
@@ -7,7 +8,38 @@ SearchServer::SearchServer(const std::string& stop_words_text)
     : SearchServer(SplitIntoWordsView(stop_words_text)) {}
 
 int SearchServer::GetDocumentCount() const {
-    return documents_.size();
+    return document_slots_.size();
+}
+
+SearchServer& SearchServer::operator=(SearchServer&& other) {
+    if (this == &other) {
+        return *this;
+    }
+    dictionary_ = std::move(other.dictionary_);
+    stop_terms_ = std::move(other.stop_terms_);
+    word_to_document_freqs_ = std::move(other.word_to_document_freqs_);
+    // The old term lists are destroyed before their arena; the lists taken over stay in the arena taken with them
+    word_freqs_used_id_ = std::move(other.word_freqs_used_id_);
+    forward_memory_ = std::move(other.forward_memory_);
+    forward_size_ = other.forward_size_;
+    released_forward_size_ = other.released_forward_size_;
+    documents_ = std::move(other.documents_);
+    // The id map keeps allocating from the pool of this server, so its nodes are moved one by one
+    document_slots_ = std::move(other.document_slots_);
+    document_ids_ = std::move(other.document_ids_);
+    status_slots_ = std::move(other.status_slots_);
+    removed_status_slot_count_ = other.removed_status_slot_count_;
+    term_document_counts_ = std::move(other.term_document_counts_);
+    removed_slots_ = std::move(other.removed_slots_);
+    tombstones_ = std::move(other.tombstones_);
+    tombstone_posting_count_ = other.tombstone_posting_count_;
+    removal_mode_ = other.removal_mode_;
+    retrieval_mode_ = other.retrieval_mode_;
+    posting_format_ = other.posting_format_;
+    corpus_version_ = other.corpus_version_;
+    idf_cache_ = std::move(other.idf_cache_);
+    query_cache_ = std::move(other.query_cache_);
+    return *this;
 }
 
 std::set<int>::const_iterator SearchServer::begin() const {
@@ -18,122 +50,287 @@ std::set<int>::const_iterator SearchServer::end()const {
     return document_ids_.end();
 }
 
-bool SearchServer::IsStopWord(const std::string_view word) const {
-    return stop_words_.count(word) > 0;
+TermId SearchServer::AddTerm(const std::string_view word) {
+    const TermId term = dictionary_.Add(word);
+    if (term == word_to_document_freqs_.size()) {
+        word_to_document_freqs_.emplace_back();
+        if (posting_format_ == PostingFormat::COMPRESSED) {
+            word_to_document_freqs_.back().Compress();
+        }
+        stop_terms_.push_back(false);
+        term_document_counts_.push_back(0);
+        idf_cache_.Resize(word_to_document_freqs_.size());
+    }
+    return term;
 }
 
-bool SearchServer::IsValidWord(const std::string_view word) {
-    return std::none_of(word.begin(), word.end(), [](char c) {
-        return c >= '\0' && c < ' ';
-        });
+void SearchServer::SplitIntoWordsNoStop(const std::string_view text, std::vector<std::string_view>& words) const {
+    const size_t invalid_word = SplitIntoWordsView(text, words);
+    if (invalid_word < words.size()) {
+        std::string word_{ words[invalid_word] };
+        throw std::invalid_argument("Word " + word_ + " is invalid");
+    }
+    words.erase(std::remove_if(words.begin(), words.end(), [this](std::string_view word) {
+        const TermId term = dictionary_.Find(word);
+        return term != INVALID_TERM_ID && stop_terms_[term];
+        }), words.end());
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view text) const {
-    std::vector<std::string_view> words;
-    for (std::string_view word : SplitIntoWordsView(text)) {
-        if (!IsValidWord(word)) {
-            std::string word_{ word };
-            throw std::invalid_argument("Word " + word_ + " is invalid");
+std::vector<TermId> SearchServer::SplitIntoTermsNoStop(const std::string_view text) {
+    static thread_local std::vector<std::string_view> words;
+    const size_t invalid_word = SplitIntoWordsView(text, words);
+    if (invalid_word < words.size()) {
+        std::string word_{ words[invalid_word] };
+        throw std::invalid_argument("Word " + word_ + " is invalid");
+    }
+    std::vector<TermId> terms;
+    terms.reserve(words.size());
+    for (std::string_view word : words) {
+        const TermId term = AddTerm(word);
+        if (!stop_terms_[term]) {
+            terms.push_back(term);
         }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+    }
+    return terms;
+}
+
+void SearchServer::FreezeStatistics() {
+    for (TermId term = 0; term < word_to_document_freqs_.size(); ++term) {
+        if (term_document_counts_[term] > 0) {
+            idf_cache_.Get(term, [this, term] {
+                return ComputeWordInverseDocumentFreq(term);
+                });
         }
     }
-    return words;
+    idf_cache_.Freeze();
+}
+
+void SearchServer::UnfreezeStatistics() {
+    idf_cache_.Unfreeze();
+    if (query_cache_) {
+        query_cache_->Clear();
+    }
 }
 
 std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
-    static std::map<std::string_view, double> empty = {};
-    return (word_freqs_used_id_.count(document_id) ? word_freqs_used_id_.at(document_id) : empty);
+    std::map<std::string_view, double> word_freqs;
+    const auto it = document_slots_.find(document_id);
+    if (it != document_slots_.end()) {
+        for (const auto [term, freq] : word_freqs_used_id_[it->second]) {
+            word_freqs.emplace(dictionary_.GetWord(term), freq);
+        }
+    }
+    return word_freqs;
 }
 
 void SearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status, 
                               const std::vector<int>& ratings) {
 
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    if ((document_id < 0) || (document_slots_.count(document_id) > 0)) {
         throw std::invalid_argument("Invalid document_id");
     }
-    const auto words = SplitIntoWordsNoStop(document);
+    std::vector<TermFreq> word_freqs = ComputeTermFreqs(SplitIntoTermsNoStop(document));
+
+    const auto slot = static_cast<DocumentSlot>(documents_.size());
+    for (const auto [term, freq] : word_freqs) {
+        word_to_document_freqs_[term].Add(slot, freq);
+    }
+    AppendDocument(document_id, ComputeAverageRating(ratings), status, word_freqs);
+    ++corpus_version_;
+    idf_cache_.Invalidate();
+}
+
+std::vector<std::exception_ptr> SearchServer::AddDocuments(const std::vector<RawDocument>& documents) {
+    return AddDocuments(std::execution::seq, documents);
+}
+
+std::vector<SearchServer::TermFreq> SearchServer::ComputeTermFreqs(std::vector<TermId> terms) {
+    std::sort(terms.begin(), terms.end());
+    const double inv_word_count = 1.0 / terms.size();
+    std::vector<TermFreq> word_freqs;
+    for (const TermId term : terms) {
+        if (word_freqs.empty() || word_freqs.back().term != term) {
+            word_freqs.push_back({ term, 0.0 });
+        }
+        word_freqs.back().freq += inv_word_count;
+    }
+    return word_freqs;
+}
 
-    const double inv_word_count = 1.0 / words.size();
-    for (const std::string_view word : words) {
-        auto it_word = all_words_.insert(std::string(word));
-        word_to_document_freqs_[*it_word.first][document_id] += inv_word_count;
-        word_freqs_used_id_[document_id][*it_word.first] += inv_word_count;
+// Registers a document whose postings have already been added under the next free slot
+void SearchServer::AppendDocument(int document_id, int rating, DocumentStatus status,
+                                  const std::vector<TermFreq>& word_freqs) {
+    const auto slot = static_cast<DocumentSlot>(documents_.size());
+    for (const TermFreq& term_freq : word_freqs) {
+        ++term_document_counts_[term_freq.term];
     }
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status });
+    word_freqs_used_id_.emplace_back(word_freqs.begin(), word_freqs.end(), forward_memory_.get());
+    forward_size_ += word_freqs.size();
+    documents_.Append(document_id, rating, status);
+    status_slots_[static_cast<size_t>(status)].push_back(slot);
+    document_slots_.emplace(document_id, slot);
     document_ids_.insert(document_id);
+    removed_slots_.push_back(false);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status) const {
-    return FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-        });
+void SearchServer::ReleaseTermFreqs(DocumentSlot slot) {
+    released_forward_size_ += word_freqs_used_id_[slot].size();
+    TermFreqs(forward_memory_.get()).swap(word_freqs_used_id_[slot]);
+}
+
+void SearchServer::CompactStatusSlots() {
+    for (std::vector<DocumentSlot>& status_slots : status_slots_) {
+        status_slots.erase(std::remove_if(status_slots.begin(), status_slots.end(), [this](DocumentSlot slot) {
+            return removed_slots_[slot];
+            }), status_slots.end());
+    }
+    removed_status_slot_count_ = 0;
+}
+
+void SearchServer::ShrinkForwardIndex() {
+    if (released_forward_size_ * 2 <= forward_size_) {
+        return;
+    }
+    auto forward_memory = std::make_unique<std::pmr::monotonic_buffer_resource>();
+    std::vector<TermFreqs> word_freqs;
+    word_freqs.reserve(word_freqs_used_id_.size());
+    for (const TermFreqs& document_freqs : word_freqs_used_id_) {
+        word_freqs.emplace_back(document_freqs.begin(), document_freqs.end(), forward_memory.get());
+    }
+    // The old lists are destroyed before their arena
+    word_freqs_used_id_ = std::move(word_freqs);
+    forward_memory_ = std::move(forward_memory);
+    forward_size_ -= released_forward_size_;
+    released_forward_size_ = 0;
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status,
+                                                     size_t max_result_count) const {
+    return FindTopDocuments(std::execution::seq, raw_query, status, max_result_count);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view raw_query) const {
     return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
 }
 
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, 
-                                                                        int document_id) const {
-    if (!document_ids_.count(document_id)) {
-        throw std::out_of_range("out_of_range ");
-    }
-    const Query query = ParseQuery(raw_query, true);
+std::vector<std::vector<Document>> SearchServer::FindTopDocumentsBatch(ThreadPool& pool,
+                                                                      const std::vector<std::string_view>& raw_queries,
+                                                                      DocumentStatus status, size_t max_result_count) const {
+    std::vector<Query> queries(raw_queries.size());
+    pool.Run(queries.size(), [&](size_t i) {
+        queries[i] = ParseQuery(raw_queries[i], true);
+        });
 
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            return { std::vector<std::string_view>{}, documents_.at(document_id).status };
+    // Every query is answered by the first of its group of identical queries
+    std::vector<size_t> query_order(queries.size());
+    std::iota(query_order.begin(), query_order.end(), 0);
+    std::sort(query_order.begin(), query_order.end(), [&queries](size_t lhs, size_t rhs) {
+        return std::tie(queries[lhs].plus_terms, queries[lhs].minus_terms, lhs)
+            < std::tie(queries[rhs].plus_terms, queries[rhs].minus_terms, rhs);
+        });
+    std::vector<size_t> unique_queries;
+    std::vector<size_t> answers(queries.size());
+    std::vector<size_t> answer_uses;
+    for (const size_t i : query_order) {
+        if (unique_queries.empty() || queries[unique_queries.back()].plus_terms != queries[i].plus_terms
+            || queries[unique_queries.back()].minus_terms != queries[i].minus_terms) {
+            unique_queries.push_back(i);
+            answer_uses.push_back(0);
         }
+        answers[i] = unique_queries.size() - 1;
+        ++answer_uses.back();
     }
-    std::vector<std::string_view> matched_words;
-    for (const std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+
+    std::vector<TermId> batch_terms;
+    for (const size_t i : unique_queries) {
+        batch_terms.insert(batch_terms.end(), queries[i].plus_terms.begin(), queries[i].plus_terms.end());
+    }
+    std::sort(batch_terms.begin(), batch_terms.end());
+    batch_terms.erase(std::unique(batch_terms.begin(), batch_terms.end()), batch_terms.end());
+    std::vector<double> batch_inverse_document_freqs(batch_terms.size(), 0.0);
+    for (size_t k = 0; k < batch_terms.size(); ++k) {
+        const TermId term = batch_terms[k];
+        if (term_document_counts_[term] > 0) {
+            batch_inverse_document_freqs[k] = idf_cache_.Get(term, [this, term] {
+                return ComputeWordInverseDocumentFreq(term);
+                });
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+    }
+
+    // Longest first: the pool runs each of its queues from the front, and the short queries left at
+    // the back are stolen by threads that run out of work
+    std::vector<size_t> query_costs(unique_queries.size(), 0);
+    for (size_t u = 0; u < unique_queries.size(); ++u) {
+        const Query& query = queries[unique_queries[u]];
+        for (const std::vector<TermId>* terms : { &query.plus_terms, &query.minus_terms }) {
+            for (const TermId term : *terms) {
+                query_costs[u] += word_to_document_freqs_[term].size();
+            }
         }
     }
-    return { matched_words, documents_.at(document_id).status };
-}
+    std::vector<size_t> cost_order(unique_queries.size());
+    std::iota(cost_order.begin(), cost_order.end(), 0);
+    std::stable_sort(cost_order.begin(), cost_order.end(), [&query_costs](size_t lhs, size_t rhs) {
+        return query_costs[lhs] > query_costs[rhs];
+        });
 
-template <typename ExecutionPolicy>
-std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(ExecutionPolicy policy,
-                                                   const std::string_view raw_query, int document_id) const {
+    const DocumentStatusPredicate status_predicate{ status };
+    std::vector<std::vector<Document>> unique_results(unique_queries.size());
+    pool.Run(cost_order.size(), [&](size_t k) {
+        const size_t u = cost_order[k];
+        const Query& query = queries[unique_queries[u]];
+        std::optional<QueryCache::Key> key;
+        if (query_cache_) {
+            key = QueryCache::Key{ query.plus_terms, query.minus_terms, status, max_result_count };
+            if (auto documents = query_cache_->Find(*key, corpus_version_)) {
+                unique_results[u] = std::move(*documents);
+                return;
+            }
+        }
+        std::vector<double> inverse_document_freqs(query.plus_terms.size());
+        for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+            const auto it = std::lower_bound(batch_terms.begin(), batch_terms.end(), query.plus_terms[i]);
+            inverse_document_freqs[i] = batch_inverse_document_freqs[it - batch_terms.begin()];
+        }
+        TopDocuments top_documents(max_result_count);
+        FindDocumentsInSlotRange(query, inverse_document_freqs, status_predicate,
+                                 0, static_cast<DocumentSlot>(documents_.size()), top_documents);
+        unique_results[u] = top_documents.Extract();
+        if (key) {
+            query_cache_->Insert(*key, unique_results[u], corpus_version_);
+        }
+        });
 
-    if (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
-        return MatchDocument(policy, raw_query, document_id);
+    std::vector<std::vector<Document>> results(queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const size_t u = answers[i];
+        results[i] = --answer_uses[u] == 0 ? std::move(unique_results[u]) : unique_results[u];
     }
+    return results;
+}
 
-    if (document_ids_.count(document_id) == 0) {
-        return { {}, {} };
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::string_view raw_query, 
+                                                                        int document_id) const {
+    const auto it = document_slots_.find(document_id);
+    if (it == document_slots_.end()) {
+        throw std::out_of_range("out_of_range ");
     }
-    const Query query = ParseQuery(raw_query, false);
+    const DocumentSlot slot = it->second;
+    const Query query = ParseQuery(raw_query, true);
 
-    if (std::any_of(policy,
-        query.minus_words.begin(), query.minus_words.end(), [&](std::string_view word) {
-            const auto it = word_to_document_freqs_.find(word);
-            return it != word_to_document_freqs_.end() && it->second.count(document_id);
-        })) {
-        return { {}, documents_.at(document_id).status };
+    for (const TermId term : query.minus_terms) {
+        if (ContainsTerm(term, slot)) {
+            return { std::vector<std::string_view>{}, documents_.GetStatus(slot) };
+        }
     }
-
     std::vector<std::string_view> matched_words;
-    matched_words.reserve(query.plus_words.size());
-    auto it_copy = std::copy_if(policy,
-        query.plus_words.begin(), query.plus_words.end(), matched_words.begin(), [&](std::string_view word) {
-            const auto it = word_to_document_freqs_.find(word);
-            return it != word_to_document_freqs_.end() && it->second.count(document_id);
-        });
-
-    sort(matched_words.begin(), it_copy);
-    it_copy = unique(matched_words.begin(), it_copy);
-    return { {matched_words.begin(), it_copy}, documents_.at(document_id).status };
+    for (const TermId term : query.plus_terms) {
+        if (ContainsTerm(term, slot)) {
+            matched_words.push_back(dictionary_.GetWord(term));
+        }
+    }
+    std::sort(matched_words.begin(), matched_words.end());
+    return { matched_words, documents_.GetStatus(slot) };
 }
 
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
@@ -147,85 +344,458 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text) const {
-    if (text.empty()) {
-        throw std::invalid_argument("Query word is empty");
-    }
-    std::string_view word = text;
-    bool is_minus = false;
-    if (word[0] == '-') {
-        is_minus = true;
-        word = word.substr(1);
-    }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-        std::string word_{ word };
-        throw std::invalid_argument("Query word " + word_ + " is invalid");
-    }
-    return { word, is_minus, IsStopWord(word) };
+SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text, bool is_valid) const {
+    const auto [word, is_minus] = ParseQueryWordText(text, is_valid);
+    const TermId term = dictionary_.Find(word);
+    return { word, term, is_minus, term != INVALID_TERM_ID && stop_terms_[term] };
 }
 
 SearchServer::Query SearchServer::ParseQuery(const std::string_view text, bool flag) const {
+    static thread_local std::vector<std::string_view> words;
+    const size_t invalid_word = SplitIntoWordsView(text, words);
     Query result;
-    for (const std::string_view word : SplitIntoWordsView(text)) {
-        const QueryWord query_word = SearchServer::ParseQueryWord(word);
-        if (!query_word.is_stop) {
+    for (size_t i = 0; i < words.size(); ++i) {
+        const QueryWord query_word = SearchServer::ParseQueryWord(words[i], i != invalid_word);
+        if (!query_word.is_stop && query_word.term != INVALID_TERM_ID) {
             if (query_word.is_minus) {
-                result.minus_words.push_back(query_word.data);
+                result.minus_terms.push_back(query_word.term);
             }
             else {
-                result.plus_words.push_back(query_word.data);
+                result.plus_terms.push_back(query_word.term);
             }
         }
     }
     if (flag == true) {
-        std::sort(result.minus_words.begin(), result.minus_words.end());
-        auto last_minus = std::unique(result.minus_words.begin(), result.minus_words.end());
-        result.minus_words.erase(last_minus, result.minus_words.end());
-        std::sort(result.plus_words.begin(), result.plus_words.end());
-        auto last_plus = std::unique(result.plus_words.begin(), result.plus_words.end());
-        result.plus_words.erase(last_plus, result.plus_words.end());
+        std::sort(result.minus_terms.begin(), result.minus_terms.end());
+        auto last_minus = std::unique(result.minus_terms.begin(), result.minus_terms.end());
+        result.minus_terms.erase(last_minus, result.minus_terms.end());
+        std::sort(result.plus_terms.begin(), result.plus_terms.end());
+        auto last_plus = std::unique(result.plus_terms.begin(), result.plus_terms.end());
+        result.plus_terms.erase(last_plus, result.plus_terms.end());
     }
     return result;
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+bool SearchServer::ContainsTerm(TermId term, DocumentSlot slot) const {
+    return word_to_document_freqs_[term].Contains(slot);
 }
 
-void SearchServer::RemoveDocument(int document_id) {
-    if (!document_ids_.count(document_id)) {
-        return;
+double SearchServer::ComputeWordInverseDocumentFreq(TermId term) const {
+    return log(GetDocumentCount() * 1.0 / term_document_counts_[term]);
+}
+
+std::vector<const PostingList*> SearchServer::ExcludeMinusDocuments(const Query& query, DocumentSlot first,
+                                                                   DocumentSlot last, ScoreAccumulator& accumulator) const {
+    size_t plus_posting_count = 0;
+    for (const TermId term : query.plus_terms) {
+        plus_posting_count += word_to_document_freqs_[term].size();
     }
-    documents_.erase(document_id);
-    document_ids_.erase(document_id);
-    word_freqs_used_id_.erase(document_id);
-    for (auto& [word, id_freq] : word_to_document_freqs_) {
-        if (id_freq.count(document_id)) {
-            id_freq.erase(document_id);
+    std::vector<const PostingList*> probed_postings;
+    for (const TermId term : query.minus_terms) {
+        const PostingList& postings = word_to_document_freqs_[term];
+        // Walking the list costs a step per posting, probing it a binary search per scored document
+        if (postings.size() > MINUS_PROBE_STEP_COST * plus_posting_count * std::log2(postings.size() + 1.0)) {
+            probed_postings.push_back(&postings);
+            continue;
         }
+        postings.ForEachInRange(first, last, [&accumulator, first](DocumentSlot slot, double) {
+            accumulator.Exclude(slot - first);
+            });
     }
+    return probed_postings;
 }
 
-template <typename ExecutionPolicy>
-void SearchServer::RemoveDocument(ExecutionPolicy policy, int document_id) {
+bool SearchServer::FindDocumentsWithStatus(const Query& query, const std::vector<double>& inverse_document_freqs,
+                                           DocumentStatus status, DocumentSlot first, DocumentSlot last,
+                                           TopDocuments& top_documents) const {
+    if (first == last) {
+        return false;
+    }
+    const std::vector<DocumentSlot>& status_slots = status_slots_[static_cast<size_t>(status)];
+    const auto slots_begin = std::lower_bound(status_slots.begin(), status_slots.end(), first);
+    const auto slots_end = std::lower_bound(slots_begin, status_slots.end(), last);
+    // Walking costs a step per posting in the slot range, probing a binary search per term and document
+    const double range_share = (last - first) * 1.0 / documents_.size();
+    double walk_cost = 0.0;
+    double probe_cost = 0.0;
+    for (const TermId term : query.plus_terms) {
+        const size_t posting_count = word_to_document_freqs_[term].size();
+        walk_cost += posting_count * range_share;
+        probe_cost += MINUS_PROBE_STEP_COST * std::log2(posting_count + 1.0) * (slots_end - slots_begin);
+    }
+    if (probe_cost >= walk_cost) {
+        return false;
+    }
 
-    if (std::is_same_v<ExecutionPolicy, std::execution::sequenced_policy>) {
-        return RemoveDocument(document_id);
+    for (auto it = slots_begin; it != slots_end; ++it) {
+        const DocumentSlot slot = *it;
+        if (removed_slots_[slot]) {
+            continue;
+        }
+        // Summed in query order, as the postings walk sums it
+        bool is_matched = false;
+        double relevance = 0.0;
+        for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+            if (const double term_freq = word_to_document_freqs_[query.plus_terms[i]].FindTermFreq(slot); term_freq > 0.0) {
+                relevance += term_freq * inverse_document_freqs[i];
+                is_matched = true;
+            }
+        }
+        if (!is_matched || std::any_of(query.minus_terms.begin(), query.minus_terms.end(), [this, slot](TermId term) {
+                return ContainsTerm(term, slot);
+            })) {
+            continue;
+        }
+        top_documents.Push({ documents_.GetId(slot), relevance, documents_.GetRating(slot) });
     }
+    return true;
+}
+
+// SplitMix64: the golden ratio step of its state, then its finalizer. Without the step 0 would map to 0.
+uint64_t SearchServer::MixHash(uint64_t value) {
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+double SearchServer::ComputeSimilarity(int document_id, int other_document_id) const {
+    const auto it = document_slots_.find(document_id);
+    const auto other_it = document_slots_.find(other_document_id);
+    if (it == document_slots_.end() || other_it == document_slots_.end()) {
+        return 0.0;
+    }
+    return ComputeSimilarity(word_freqs_used_id_[it->second], word_freqs_used_id_[other_it->second]);
+}
+
+// Term lists are sorted by term, so the common terms are counted in one merge pass
+double SearchServer::ComputeSimilarity(const TermFreqs& lhs, const TermFreqs& rhs) {
+    size_t common_count = 0;
+    for (auto lhs_it = lhs.begin(), rhs_it = rhs.begin(); lhs_it != lhs.end() && rhs_it != rhs.end();) {
+        if (lhs_it->term < rhs_it->term) {
+            ++lhs_it;
+        }
+        else if (rhs_it->term < lhs_it->term) {
+            ++rhs_it;
+        }
+        else {
+            ++common_count;
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    const size_t union_count = lhs.size() + rhs.size() - common_count;
+    return union_count > 0 ? common_count * 1.0 / union_count : 0.0;
+}
+
+bool SearchServer::ContainsAny(const std::vector<const PostingList*>& postings, DocumentSlot slot) {
+    return std::any_of(postings.begin(), postings.end(), [slot](const PostingList* term_postings) {
+        return term_postings->Contains(slot);
+        });
+}
+
+std::vector<double> SearchServer::ComputeInverseDocumentFreqs(const Query& query) const {
+    std::vector<double> inverse_document_freqs(query.plus_terms.size(), 0.0);
+    for (size_t i = 0; i < query.plus_terms.size(); ++i) {
+        if (term_document_counts_[query.plus_terms[i]] > 0) {
+            const TermId term = query.plus_terms[i];
+            inverse_document_freqs[i] = idf_cache_.Get(term, [this, term] {
+                return ComputeWordInverseDocumentFreq(term);
+                });
+        }
+    }
+    return inverse_document_freqs;
+}
+
+void SearchServer::RemoveDocument(int document_id) {
+    RemoveDocument(std::execution::seq, document_id);
+}
 
-    if (documents_.count(document_id) == 0) {
+void SearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    RemoveDocuments(std::execution::seq, document_ids);
+}
+
+std::vector<int> SearchServer::FindDuplicateDocuments() const {
+    return FindDuplicateDocuments(std::execution::seq);
+}
+
+std::vector<std::vector<int>> SearchServer::FindNearDuplicates(double threshold) const {
+    return FindNearDuplicates(std::execution::seq, threshold);
+}
+
+void SearchServer::SetRemovalMode(RemovalMode mode) {
+    if (mode == RemovalMode::IMMEDIATE) {
+        CompactIndex();
+    }
+    removal_mode_ = mode;
+}
+
+void SearchServer::SetRetrievalMode(RetrievalMode mode) {
+    retrieval_mode_ = mode;
+}
+
+void SearchServer::EnableQueryCache(size_t max_memory_bytes) {
+    query_cache_ = std::make_unique<QueryCache>(max_memory_bytes);
+}
+
+void SearchServer::DisableQueryCache() {
+    query_cache_.reset();
+}
+
+QueryCache::Stats SearchServer::GetQueryCacheStats() const {
+    return query_cache_ ? query_cache_->GetStats() : QueryCache::Stats{};
+}
+
+void SearchServer::SetPostingFormat(PostingFormat format) {
+    if (format == posting_format_) {
         return;
     }
-    const auto& word_freqs = word_freqs_used_id_.at(document_id);
-    std::vector<std::string> words(word_freqs.size());
-    transform(policy, word_freqs.begin(), word_freqs.end(), words.begin(), [](const auto& item) {
-        return item.first;
+    posting_format_ = format;
+    std::for_each(std::execution::par, word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
+        [format](PostingList& postings) {
+            if (format == PostingFormat::COMPRESSED) {
+                postings.Compress();
+            }
+            else {
+                postings.Decompress();
+            }
+        });
+    ++corpus_version_;
+}
+
+bool SearchServer::ApplyCompaction(IndexCompaction&& compaction) {
+    if (compaction.corpus_version != corpus_version_ || compaction.slots.size() != tombstones_.size()) {
+        return false;
+    }
+    for (auto& [term, postings] : compaction.postings) {
+        word_to_document_freqs_[term] = std::move(postings);
+    }
+    for (const DocumentSlot slot : compaction.slots) {
+        ReleaseTermFreqs(slot);
+    }
+    tombstones_.clear();
+    tombstone_posting_count_ = 0;
+    ShrinkForwardIndex();
+    CompactStatusSlots();
+    return true;
+}
+
+void SearchServer::CompactIndex() {
+    CompactIndex(std::execution::seq);
+}
+
+void SearchServer::SaveSnapshot(const std::string& path) const {
+    SnapshotWriter writer(path);
+
+    const TermId term_count = static_cast<TermId>(dictionary_.size());
+    writer.WriteValue(term_count);
+    uint64_t chars_size = 0;
+    writer.BeginArray(term_count + 1);
+    for (TermId term = 0; term <= term_count; ++term) {
+        writer.WriteElements(&chars_size, 1);
+        if (term < term_count) {
+            chars_size += dictionary_.GetWord(term).size();
+        }
+    }
+    writer.EndArray();
+    writer.BeginArray(chars_size);
+    for (TermId term = 0; term < term_count; ++term) {
+        const std::string_view word = dictionary_.GetWord(term);
+        writer.WriteElements(word.data(), word.size());
+    }
+    writer.EndArray();
+    writer.WriteArray(std::vector<uint8_t>(stop_terms_.begin(), stop_terms_.end()));
+    std::vector<TermId> sorted_terms(term_count);
+    std::iota(sorted_terms.begin(), sorted_terms.end(), 0);
+    std::sort(sorted_terms.begin(), sorted_terms.end(), [this](TermId lhs, TermId rhs) {
+        return dictionary_.GetWord(lhs) < dictionary_.GetWord(rhs);
         });
-    for_each(policy, words.begin(), words.end(), [this, document_id](std::string word) {
-        word_to_document_freqs_.find(word)->second.erase(document_id);
+    writer.WriteArray(sorted_terms);
+
+    // Removed documents are left out, and the remaining slots are renumbered densely
+    std::vector<DocumentSlot> live_slots;
+    std::vector<DocumentSlot> new_slots(documents_.size());
+    for (DocumentSlot slot = 0; slot < documents_.size(); ++slot) {
+        if (!removed_slots_[slot]) {
+            new_slots[slot] = static_cast<DocumentSlot>(live_slots.size());
+            live_slots.push_back(slot);
+        }
+    }
+    writer.WriteValue(live_slots.size());
+    std::vector<int> ids;
+    std::vector<int> ratings;
+    std::vector<uint8_t> statuses;
+    for (const DocumentSlot slot : live_slots) {
+        ids.push_back(documents_.GetId(slot));
+        ratings.push_back(documents_.GetRating(slot));
+        statuses.push_back(static_cast<uint8_t>(documents_.GetStatus(slot)));
+    }
+    writer.WriteArray(ids);
+    writer.WriteArray(ratings);
+    writer.WriteArray(statuses);
+    std::vector<DocumentSlot> slots_by_id(live_slots.size());
+    std::iota(slots_by_id.begin(), slots_by_id.end(), 0);
+    std::sort(slots_by_id.begin(), slots_by_id.end(), [&ids](DocumentSlot lhs, DocumentSlot rhs) {
+        return ids[lhs] < ids[rhs];
         });
+    writer.WriteArray(slots_by_id);
 
-    document_ids_.erase(document_id);
-    documents_.erase(document_id);
-    word_freqs_used_id_.erase(document_id);
-}
\ No newline at end of file
+    uint64_t postings_size = 0;
+    writer.BeginArray(term_count + 1);
+    for (TermId term = 0; term <= term_count; ++term) {
+        writer.WriteElements(&postings_size, 1);
+        if (term < term_count) {
+            postings_size += term_document_counts_[term];
+        }
+    }
+    writer.EndArray();
+    writer.BeginArray(postings_size);
+    std::vector<DocumentSlot> term_slots;
+    for (const PostingList& postings : word_to_document_freqs_) {
+        term_slots.clear();
+        postings.ForEach([&](DocumentSlot slot, double) {
+            if (!removed_slots_[slot]) {
+                term_slots.push_back(new_slots[slot]);
+            }
+            });
+        writer.WriteElements(term_slots.data(), term_slots.size());
+    }
+    writer.EndArray();
+    writer.BeginArray(postings_size);
+    std::vector<double> term_freqs;
+    for (const PostingList& postings : word_to_document_freqs_) {
+        term_freqs.clear();
+        postings.ForEach([&](DocumentSlot slot, double term_freq) {
+            if (!removed_slots_[slot]) {
+                term_freqs.push_back(term_freq);
+            }
+            });
+        writer.WriteElements(term_freqs.data(), term_freqs.size());
+    }
+    writer.EndArray();
+
+    uint64_t forward_size = 0;
+    writer.BeginArray(live_slots.size() + 1);
+    for (size_t i = 0; i <= live_slots.size(); ++i) {
+        writer.WriteElements(&forward_size, 1);
+        if (i < live_slots.size()) {
+            forward_size += word_freqs_used_id_[live_slots[i]].size();
+        }
+    }
+    writer.EndArray();
+    writer.BeginArray(forward_size);
+    for (const DocumentSlot slot : live_slots) {
+        for (const TermFreq& term_freq : word_freqs_used_id_[slot]) {
+            writer.WriteElements(&term_freq.term, 1);
+        }
+    }
+    writer.EndArray();
+    writer.BeginArray(forward_size);
+    for (const DocumentSlot slot : live_slots) {
+        for (const TermFreq& term_freq : word_freqs_used_id_[slot]) {
+            writer.WriteElements(&term_freq.freq, 1);
+        }
+    }
+    writer.EndArray();
+
+    writer.Finish();
+}
+
+void SearchServer::LoadSnapshot(const std::string& path) {
+    SnapshotReader reader(path);
+    const uint64_t term_count = reader.ReadValue();
+    const auto term_offsets = reader.ReadArray<uint64_t>();
+    const auto term_chars = reader.ReadArray<char>();
+    const auto stop_flags = reader.ReadArray<uint8_t>();
+    reader.ReadArray<TermId>();
+    const uint64_t document_count = reader.ReadValue();
+    const auto ids = reader.ReadArray<int>();
+    const auto ratings = reader.ReadArray<int>();
+    const auto statuses = reader.ReadArray<uint8_t>();
+    reader.ReadArray<DocumentSlot>();
+    const auto posting_offsets = reader.ReadArray<uint64_t>();
+    const auto posting_slots = reader.ReadArray<DocumentSlot>();
+    const auto posting_freqs = reader.ReadArray<double>();
+    const auto forward_offsets = reader.ReadArray<uint64_t>();
+    const auto forward_terms = reader.ReadArray<TermId>();
+    const auto forward_freqs = reader.ReadArray<double>();
+    reader.Finish();
+
+    const auto check = [](bool condition) {
+        if (!condition) {
+            throw std::runtime_error("Snapshot contents are inconsistent");
+        }
+    };
+    const auto check_offsets = [&check](const std::vector<uint64_t>& offsets, uint64_t count, uint64_t total) {
+        check(offsets.size() == count + 1 && offsets.front() == 0 && offsets.back() == total);
+        check(std::is_sorted(offsets.begin(), offsets.end()));
+    };
+    check(term_count < INVALID_TERM_ID && stop_flags.size() == term_count);
+    check_offsets(term_offsets, term_count, term_chars.size());
+    check(ids.size() == document_count && ratings.size() == document_count && statuses.size() == document_count);
+    check_offsets(posting_offsets, term_count, posting_slots.size());
+    check(posting_freqs.size() == posting_slots.size());
+    check_offsets(forward_offsets, document_count, forward_terms.size());
+    check(forward_freqs.size() == forward_terms.size());
+    check(std::all_of(statuses.begin(), statuses.end(), [](uint8_t status) {
+        return status <= static_cast<uint8_t>(DocumentStatus::REMOVED);
+        }));
+    check(std::all_of(forward_terms.begin(), forward_terms.end(), [term_count](TermId term) {
+        return term < term_count;
+        }));
+
+    TermDictionary dictionary;
+    std::vector<PostingList> postings(term_count);
+    std::vector<uint32_t> term_document_counts(term_count);
+    for (TermId term = 0; term < term_count; ++term) {
+        const std::string_view word(term_chars.data() + term_offsets[term], term_offsets[term + 1] - term_offsets[term]);
+        check(dictionary.Add(word) == term);
+        const auto first = posting_slots.begin() + posting_offsets[term];
+        const auto last = posting_slots.begin() + posting_offsets[term + 1];
+        check(std::adjacent_find(first, last, std::greater_equal<DocumentSlot>()) == last);
+        check(first == last || *(last - 1) < document_count);
+        postings[term] = PostingList(std::vector<DocumentSlot>(first, last),
+            std::vector<double>(posting_freqs.begin() + posting_offsets[term], posting_freqs.begin() + posting_offsets[term + 1]));
+        if (posting_format_ == PostingFormat::COMPRESSED) {
+            postings[term].Compress();
+        }
+        term_document_counts[term] = static_cast<uint32_t>(last - first);
+    }
+
+    DocumentAttributes documents;
+    documents.Reserve(document_count);
+    auto forward_memory = std::make_unique<std::pmr::monotonic_buffer_resource>();
+    std::vector<TermFreqs> word_freqs;
+    word_freqs.reserve(document_count);
+    std::pmr::unordered_map<int, DocumentSlot> document_slots(node_memory_.get());
+    std::array<std::vector<DocumentSlot>, DOCUMENT_STATUS_COUNT> status_slots;
+    for (DocumentSlot slot = 0; slot < document_count; ++slot) {
+        check(ids[slot] >= 0 && document_slots.emplace(ids[slot], slot).second);
+        documents.Append(ids[slot], ratings[slot], static_cast<DocumentStatus>(statuses[slot]));
+        status_slots[statuses[slot]].push_back(slot);
+        TermFreqs& document_freqs = word_freqs.emplace_back(forward_memory.get());
+        document_freqs.reserve(forward_offsets[slot + 1] - forward_offsets[slot]);
+        for (uint64_t i = forward_offsets[slot]; i < forward_offsets[slot + 1]; ++i) {
+            document_freqs.push_back({ forward_terms[i], forward_freqs[i] });
+        }
+    }
+
+    dictionary_ = std::move(dictionary);
+    stop_terms_.assign(stop_flags.begin(), stop_flags.end());
+    word_to_document_freqs_ = std::move(postings);
+    word_freqs_used_id_ = std::move(word_freqs);
+    forward_memory_ = std::move(forward_memory);
+    forward_size_ = forward_terms.size();
+    released_forward_size_ = 0;
+    documents_ = std::move(documents);
+    document_slots_ = std::move(document_slots);
+    document_ids_ = std::set<int>(ids.begin(), ids.end());
+    status_slots_ = std::move(status_slots);
+    removed_status_slot_count_ = 0;
+    term_document_counts_ = std::move(term_document_counts);
+    removed_slots_.assign(document_count, false);
+    tombstones_.clear();
+    tombstone_posting_count_ = 0;
+    ++corpus_version_;
+    idf_cache_.Reset(term_count);
+}
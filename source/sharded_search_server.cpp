@@ -0,0 +1,145 @@
+#include "sharded_search_server.h"
+
+#include <cmath>
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const std::string_view stop_words_text)
+    : ShardedSearchServer(shard_count, SplitIntoWordsView(stop_words_text)) {}
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const std::string& stop_words_text)
+    : ShardedSearchServer(shard_count, SplitIntoWordsView(stop_words_text)) {}
+
+void ShardedSearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+    if (document_id < 0) {
+        throw std::invalid_argument("Invalid document_id");
+    }
+    GetShard(document_id).AddDocument(document_id, document, status, ratings);
+}
+
+std::vector<std::exception_ptr> ShardedSearchServer::AddDocuments(const std::vector<RawDocument>& documents) {
+    std::vector<std::exception_ptr> errors(documents.size());
+    std::vector<std::vector<size_t>> shard_indexes(shards_.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        if (documents[i].id < 0) {
+            errors[i] = std::make_exception_ptr(std::invalid_argument("Invalid document_id"));
+            continue;
+        }
+        shard_indexes[GetShardIndex(documents[i].id)].push_back(i);
+    }
+    ThreadPool::Shared().Run(shards_.size(), [&](size_t shard) {
+        std::vector<RawDocument> shard_documents;
+        shard_documents.reserve(shard_indexes[shard].size());
+        for (const size_t i : shard_indexes[shard]) {
+            shard_documents.push_back(documents[i]);
+        }
+        const std::vector<std::exception_ptr> shard_errors = shards_[shard].AddDocuments(shard_documents);
+        for (size_t k = 0; k < shard_errors.size(); ++k) {
+            errors[shard_indexes[shard][k]] = shard_errors[k];
+        }
+        });
+    return errors;
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    if (document_id >= 0) {
+        GetShard(document_id).RemoveDocument(document_id);
+    }
+}
+
+void ShardedSearchServer::RemoveDocuments(const std::vector<int>& document_ids) {
+    std::vector<std::vector<int>> shard_document_ids(shards_.size());
+    for (const int document_id : document_ids) {
+        if (document_id >= 0) {
+            shard_document_ids[GetShardIndex(document_id)].push_back(document_id);
+        }
+    }
+    ThreadPool::Shared().Run(shards_.size(), [this, &shard_document_ids](size_t shard) {
+        shards_[shard].RemoveDocuments(shard_document_ids[shard]);
+        });
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query, DocumentStatus status,
+                                                            size_t max_result_count) const {
+    return FindTopDocuments(raw_query, DocumentStatusPredicate{ status }, max_result_count);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view raw_query) const {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(
+    const std::string_view raw_query, int document_id) const {
+    if (document_id < 0) {
+        throw std::out_of_range("out_of_range ");
+    }
+    return GetShard(document_id).MatchDocument(raw_query, document_id);
+}
+
+std::map<std::string_view, double> ShardedSearchServer::GetWordFrequencies(int document_id) const {
+    if (document_id < 0) {
+        return {};
+    }
+    return GetShard(document_id).GetWordFrequencies(document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const SearchServer& shard : shards_) {
+        document_count += shard.GetDocumentCount();
+    }
+    return document_count;
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+    return shards_.size();
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+    // 32-bit finalizer of MurmurHash3, so that consecutive ids spread evenly
+    auto hash = static_cast<uint32_t>(document_id);
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35U;
+    hash ^= hash >> 16;
+    return hash % shards_.size();
+}
+
+SearchServer& ShardedSearchServer::GetShard(int document_id) {
+    return shards_[GetShardIndex(document_id)];
+}
+
+const SearchServer& ShardedSearchServer::GetShard(int document_id) const {
+    return shards_[GetShardIndex(document_id)];
+}
+
+std::vector<std::vector<double>> ShardedSearchServer::ComputeInverseDocumentFreqs(
+    const std::vector<SearchServer::Query>& queries) const {
+    std::unordered_map<std::string_view, int> word_document_counts;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        for (const TermId term : queries[i].plus_terms) {
+            const std::string_view word = shards_[i].dictionary_.GetWord(term);
+            if (word_document_counts.count(word) > 0) {
+                continue;
+            }
+            int document_count = 0;
+            for (const SearchServer& shard : shards_) {
+                if (const TermId shard_term = shard.dictionary_.Find(word); shard_term != INVALID_TERM_ID) {
+                    document_count += shard.term_document_counts_[shard_term];
+                }
+            }
+            word_document_counts.emplace(word, document_count);
+        }
+    }
+
+    const int corpus_document_count = GetDocumentCount();
+    std::vector<std::vector<double>> inverse_document_freqs(shards_.size());
+    for (size_t i = 0; i < shards_.size(); ++i) {
+        for (const TermId term : queries[i].plus_terms) {
+            const int document_count = word_document_counts.at(shards_[i].dictionary_.GetWord(term));
+            inverse_document_freqs[i].push_back(
+                document_count > 0 ? std::log(corpus_document_count * 1.0 / document_count) : 0.0);
+        }
+    }
+    return inverse_document_freqs;
+}
@@ -0,0 +1,184 @@
+#include "snapshot_io.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+void SnapshotChecksum::Update(const void* data, size_t size) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    total_size_ += size;
+    while (size > 0 && pending_size_ > 0) {
+        pending_ |= static_cast<uint64_t>(*bytes++) << (8 * pending_size_++);
+        --size;
+        if (pending_size_ == 8) {
+            Mix(pending_);
+            pending_ = 0;
+            pending_size_ = 0;
+        }
+    }
+    for (; size >= 8; bytes += 8, size -= 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes, 8);
+        Mix(word);
+    }
+    for (; size > 0; --size) {
+        pending_ |= static_cast<uint64_t>(*bytes++) << (8 * pending_size_++);
+    }
+}
+
+uint64_t SnapshotChecksum::Get() const {
+    uint64_t hash = hash_;
+    hash = (hash ^ pending_) * 1099511628211ull;
+    hash = (hash ^ total_size_) * 1099511628211ull;
+    return hash ^ (hash >> 29);
+}
+
+void ValidateSnapshotHeader(const SnapshotHeader& header, const std::string& source) {
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        throw std::runtime_error(source + " is not a search server snapshot");
+    }
+    if (header.format_version != SNAPSHOT_FORMAT_VERSION) {
+        throw std::runtime_error("Unsupported snapshot format version " + std::to_string(header.format_version));
+    }
+    if (header.byte_order_mark != SNAPSHOT_BYTE_ORDER_MARK) {
+        throw std::runtime_error("Snapshot was written on a machine with a different byte order");
+    }
+}
+
+SnapshotWriter::SnapshotWriter(const std::string& path)
+    : path_(path)
+    , temp_path_(path + ".tmp")
+    , out_(temp_path_, std::ios::binary | std::ios::trunc) {
+    if (!out_) {
+        throw std::runtime_error("Cannot open snapshot file " + temp_path_ + " for writing");
+    }
+    const SnapshotHeader header = {};
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (!is_finished_) {
+        out_.close();
+        std::remove(temp_path_.c_str());
+    }
+}
+
+void SnapshotWriter::WriteValue(uint64_t value) {
+    Write(&value, sizeof(value));
+}
+
+void SnapshotWriter::BeginArray(uint64_t count) {
+    WriteValue(count);
+    array_start_ = payload_size_;
+}
+
+void SnapshotWriter::EndArray() {
+    static const char zeros[8] = {};
+    Write(zeros, (8 - (payload_size_ - array_start_) % 8) % 8);
+}
+
+void SnapshotWriter::Finish() {
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.format_version = SNAPSHOT_FORMAT_VERSION;
+    header.byte_order_mark = SNAPSHOT_BYTE_ORDER_MARK;
+    header.payload_size = payload_size_;
+    header.checksum = checksum_.Get();
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.close();
+    if (!out_) {
+        throw std::runtime_error("Failed to write snapshot");
+    }
+    // Replaces an existing snapshot in one step, on Windows as well
+    std::error_code error;
+    std::filesystem::rename(temp_path_, path_, error);
+    if (error) {
+        throw std::runtime_error("Cannot replace snapshot file " + path_ + ": " + error.message());
+    }
+    is_finished_ = true;
+}
+
+void SnapshotWriter::Write(const void* data, size_t size) {
+    out_.write(static_cast<const char*>(data), size);
+    checksum_.Update(data, size);
+    payload_size_ += size;
+}
+
+SnapshotReader::SnapshotReader(const std::string& path) : in_(path, std::ios::binary) {
+    if (!in_) {
+        throw std::runtime_error("Cannot open snapshot file " + path);
+    }
+    in_.read(reinterpret_cast<char*>(&header_), sizeof(header_));
+    if (!in_) {
+        throw std::runtime_error(path + " is not a search server snapshot");
+    }
+    ValidateSnapshotHeader(header_, path);
+    remaining_ = header_.payload_size;
+}
+
+uint64_t SnapshotReader::ReadValue() {
+    uint64_t value;
+    Read(&value, sizeof(value));
+    return value;
+}
+
+void SnapshotReader::Finish() {
+    if (remaining_ != 0 || checksum_.Get() != header_.checksum) {
+        throw std::runtime_error("Snapshot checksum mismatch");
+    }
+}
+
+void SnapshotReader::Read(void* data, size_t size) {
+    if (size > remaining_) {
+        throw std::runtime_error("Snapshot is truncated or corrupted");
+    }
+    in_.read(static_cast<char*>(data), size);
+    if (!in_) {
+        throw std::runtime_error("Snapshot is truncated or corrupted");
+    }
+    checksum_.Update(data, size);
+    remaining_ -= size;
+}
+
+void SnapshotReader::SkipPadding(uint64_t size) {
+    char padding[8];
+    Read(padding, (8 - size % 8) % 8);
+}
+
+SnapshotMemoryReader::SnapshotMemoryReader(const char* data, size_t size, const std::string& source) {
+    if (size < sizeof(header_)) {
+        throw std::runtime_error(source + " is not a search server snapshot");
+    }
+    std::memcpy(&header_, data, sizeof(header_));
+    ValidateSnapshotHeader(header_, source);
+    if (header_.payload_size != size - sizeof(header_)) {
+        throw std::runtime_error("Snapshot is truncated or corrupted");
+    }
+    payload_ = data + sizeof(header_);
+    position_ = payload_;
+    remaining_ = header_.payload_size;
+}
+
+uint64_t SnapshotMemoryReader::ReadValue() {
+    if (remaining_ < sizeof(uint64_t)) {
+        throw std::runtime_error("Snapshot is truncated or corrupted");
+    }
+    uint64_t value;
+    std::memcpy(&value, position_, sizeof(value));
+    position_ += sizeof(value);
+    remaining_ -= sizeof(value);
+    return value;
+}
+
+void SnapshotMemoryReader::Finish() const {
+    if (remaining_ != 0) {
+        throw std::runtime_error("Snapshot is truncated or corrupted");
+    }
+}
+
+bool SnapshotMemoryReader::VerifyChecksum() const {
+    SnapshotChecksum checksum;
+    checksum.Update(payload_, header_.payload_size);
+    return checksum.Get() == header_.checksum;
+}
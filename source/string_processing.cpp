@@ -1,5 +1,12 @@
 #include "string_processing.h"
 
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
 std::vector<std::string> SplitIntoWords(const std::string& text) {
     std::vector<std::string> words;
     std::string word;
@@ -21,17 +28,166 @@ std::vector<std::string> SplitIntoWords(const std::string& text) {
 }
 
 
-std::vector<std::string_view> SplitIntoWordsView(std::string_view text) {
-    std::vector<std::string_view> words;
-    while (true) {
-        const int64_t space = text.find(' ');
-        words.push_back(text.substr(0, space));
-        if (space == text.npos) {
-            break;
+namespace {
+
+bool IsControlChar(char c) {
+    return static_cast<unsigned char>(c) < ' ';
+}
+
+// Each splitter handles the whole text: full vector-width chunks first, then the rest byte by byte.
+// first_invalid receives the position of the first control character, or text.size().
+size_t SplitTail(std::string_view text, size_t pos, size_t word_start, size_t& first_invalid,
+                 std::vector<std::string_view>& words) {
+    for (; pos < text.size(); ++pos) {
+        if (text[pos] == ' ') {
+            words.push_back(text.substr(word_start, pos - word_start));
+            word_start = pos + 1;
         }
-        else {
-            text.remove_prefix(space + 1);
+        else if (first_invalid == text.size() && IsControlChar(text[pos])) {
+            first_invalid = pos;
+        }
+    }
+    return word_start;
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+inline unsigned CountTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+// Emits the words ending at the spaces marked in space_mask for the chunk starting at chunk_start
+inline size_t EmitWords(std::string_view text, size_t chunk_start, uint32_t space_mask, size_t word_start,
+                        std::vector<std::string_view>& words) {
+    while (space_mask != 0) {
+        const size_t pos = chunk_start + CountTrailingZeros(space_mask);
+        words.push_back(text.substr(word_start, pos - word_start));
+        word_start = pos + 1;
+        space_mask &= space_mask - 1;
+    }
+    return word_start;
+}
+
+void SplitSse2(std::string_view text, size_t& first_invalid, std::vector<std::string_view>& words) {
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i control_max = _mm_set1_epi8(' ' - 1);
+    size_t word_start = 0;
+    size_t pos = 0;
+    for (; pos + 16 <= text.size(); pos += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+        const auto space_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, spaces)));
+        if (first_invalid == text.size()) {
+            // Unsigned chunk <= 31, i.e. min(chunk, 31) == chunk
+            const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, control_max), chunk);
+            const auto control_mask = static_cast<uint32_t>(_mm_movemask_epi8(control));
+            if (control_mask != 0) {
+                first_invalid = pos + CountTrailingZeros(control_mask);
+            }
+        }
+        word_start = EmitWords(text, pos, space_mask, word_start, words);
+    }
+    word_start = SplitTail(text, pos, word_start, first_invalid, words);
+    words.push_back(text.substr(word_start));
+}
+
+#if defined(__GNUC__)
+#define SEARCH_SERVER_HAS_AVX2
+__attribute__((target("avx2")))
+void SplitAvx2(std::string_view text, size_t& first_invalid, std::vector<std::string_view>& words) {
+    const __m256i spaces = _mm256_set1_epi8(' ');
+    const __m256i control_max = _mm256_set1_epi8(' ' - 1);
+    size_t word_start = 0;
+    size_t pos = 0;
+    for (; pos + 32 <= text.size(); pos += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + pos));
+        const auto space_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, spaces)));
+        if (first_invalid == text.size()) {
+            const __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control_max), chunk);
+            const auto control_mask = static_cast<uint32_t>(_mm256_movemask_epi8(control));
+            if (control_mask != 0) {
+                first_invalid = pos + CountTrailingZeros(control_mask);
+            }
         }
+        word_start = EmitWords(text, pos, space_mask, word_start, words);
     }
+    word_start = SplitTail(text, pos, word_start, first_invalid, words);
+    words.push_back(text.substr(word_start));
+}
+#endif
+
+#else
+
+void SplitScalar(std::string_view text, size_t& first_invalid, std::vector<std::string_view>& words) {
+    const size_t word_start = SplitTail(text, 0, 0, first_invalid, words);
+    words.push_back(text.substr(word_start));
+}
+
+#endif
+
+using Splitter = void (*)(std::string_view, size_t&, std::vector<std::string_view>&);
+
+Splitter SelectSplitter() {
+#if defined(SEARCH_SERVER_HAS_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        return SplitAvx2;
+    }
+#endif
+#if defined(__x86_64__) || defined(_M_X64)
+    return SplitSse2;
+#else
+    return SplitScalar;
+#endif
+}
+
+}  // namespace
+
+std::vector<std::string_view> SplitIntoWordsView(std::string_view text) {
+    std::vector<std::string_view> words;
+    SplitIntoWordsView(text, words);
     return words;
-}
\ No newline at end of file
+}
+
+size_t SplitIntoWordsView(std::string_view text, std::vector<std::string_view>& words) {
+    static const Splitter split = SelectSplitter();
+    words.clear();
+    size_t first_invalid = text.size();
+    split(text, first_invalid, words);
+    if (first_invalid == text.size()) {
+        return words.size();
+    }
+    // Words are ordered by position, so the invalid one is the last word starting at or before it
+    const char* invalid_char = text.data() + first_invalid;
+    const auto it = std::upper_bound(words.begin(), words.end(), invalid_char,
+        [](const char* position, std::string_view word) {
+            return position < word.data();
+        });
+    return static_cast<size_t>(it - words.begin()) - 1;
+}
+
+bool IsValidWord(std::string_view word) {
+    return std::none_of(word.begin(), word.end(), [](char c) {
+        return c >= '\0' && c < ' ';
+        });
+}
+
+QueryWordText ParseQueryWordText(std::string_view text, bool is_valid) {
+    if (text.empty()) {
+        throw std::invalid_argument("Query word is empty");
+    }
+    QueryWordText result{ text };
+    if (result.word[0] == '-') {
+        result.is_minus = true;
+        result.word.remove_prefix(1);
+    }
+    if (result.word.empty() || result.word[0] == '-' || !is_valid) {
+        std::string word_{ result.word };
+        throw std::invalid_argument("Query word " + word_ + " is invalid");
+    }
+    return result;
+}
@@ -0,0 +1,74 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+#include <functional>
+
+TermDictionary::TermDictionary() : slots_(16) {
+}
+
+TermId TermDictionary::Add(std::string_view word) {
+    const uint32_t hash = Hash(word);
+    size_t slot = FindSlot(word, hash);
+    if (slots_[slot].term != INVALID_TERM_ID) {
+        return slots_[slot].term;
+    }
+    if ((words_.size() + 1) * 2 > slots_.size()) {
+        Grow();
+        slot = FindSlot(word, hash);
+    }
+    const TermId term = static_cast<TermId>(words_.size());
+    words_.push_back(StoreWord(word));
+    slots_[slot] = { hash, term };
+    return term;
+}
+
+TermId TermDictionary::Find(std::string_view word) const {
+    return slots_[FindSlot(word, Hash(word))].term;
+}
+
+std::string_view TermDictionary::StoreWord(std::string_view word) {
+    if (word.size() > chunk_free_size_) {
+        const size_t chunk_size = std::max(CHUNK_SIZE, word.size());
+        chunks_.push_back(std::make_unique<char[]>(chunk_size));
+        chunk_free_ = chunks_.back().get();
+        chunk_free_size_ = chunk_size;
+    }
+    const std::string_view stored(chunk_free_, word.size());
+    std::copy(word.begin(), word.end(), chunk_free_);
+    chunk_free_ += word.size();
+    chunk_free_size_ -= word.size();
+    return stored;
+}
+
+uint32_t TermDictionary::Hash(std::string_view word) {
+    const uint64_t hash = std::hash<std::string_view>{}(word);
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+size_t TermDictionary::FindSlot(std::string_view word, uint32_t hash) const {
+    const size_t mask = slots_.size() - 1;
+    size_t slot = hash & mask;
+    while (slots_[slot].term != INVALID_TERM_ID) {
+        if (slots_[slot].hash == hash && words_[slots_[slot].term] == word) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void TermDictionary::Grow() {
+    std::vector<Slot> old_slots(slots_.size() * 2);
+    old_slots.swap(slots_);
+    const size_t mask = slots_.size() - 1;
+    for (const Slot& old_slot : old_slots) {
+        if (old_slot.term == INVALID_TERM_ID) {
+            continue;
+        }
+        size_t slot = old_slot.hash & mask;
+        while (slots_[slot].term != INVALID_TERM_ID) {
+            slot = (slot + 1) & mask;
+        }
+        slots_[slot] = old_slot;
+    }
+}
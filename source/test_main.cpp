@@ -0,0 +1,6 @@
+﻿#include "tests.h"
+
+int main() {
+    TestSearchServer();
+    return 0;
+}
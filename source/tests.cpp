@@ -312,9 +312,402 @@ void TestRelevanceSearchDocuments()
     ASSERT(abs(matched_documents[1].relevance - tf_idf2) < ACCURACY);
 }
 
+*/
+
+void TestRemoveFromCompressedPostings() {
+    for (const PostingFormat format : { PostingFormat::PLAIN, PostingFormat::COMPRESSED }) {
+        SearchServer server("in the"s);
+        server.SetPostingFormat(format);
+        // Documents in consecutive slots give blocks of zero-width slot gaps, which are re-encoded on removal
+        for (int document_id = 0; document_id < 300; ++document_id) {
+            server.AddDocument(document_id, "cat in the city"s, DocumentStatus::ACTUAL, { 1 });
+        }
+        for (int document_id = 0; document_id < 300; document_id += 3) {
+            server.RemoveDocument(document_id);
+        }
+        ASSERT_EQUAL(server.GetDocumentCount(), 200);
+        const auto found_docs = server.FindTopDocuments("cat"s, DocumentStatus::ACTUAL, 300);
+        ASSERT_EQUAL(found_docs.size(), 200u);
+        for (const Document& document : found_docs) {
+            ASSERT(document.id % 3 != 0);
+        }
+    }
+}
+
+void AssertEqualDocuments(const vector<Document>& lhs, const vector<Document>& rhs, const string& hint) {
+    ASSERT_EQUAL_HINT(lhs.size(), rhs.size(), hint);
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        ASSERT_EQUAL_HINT(lhs[i].id, rhs[i].id, hint);
+        ASSERT_EQUAL_HINT(lhs[i].rating, rhs[i].rating, hint);
+        ASSERT_HINT(abs(lhs[i].relevance - rhs[i].relevance) < ACCURACY, hint);
+    }
+}
+
+void TestMaxScoreMatchesExhaustive() {
+    const vector<string> words = { "cat"s, "dog"s, "bird"s, "fish"s, "city"s, "tail"s, "eyes"s, "hat"s, "john"s, "pigeon"s };
+    const DocumentStatus statuses[] = { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED,
+                                        DocumentStatus::REMOVED };
+    SearchServer exhaustive("in the"s);
+    SearchServer max_score("in the"s);
+    exhaustive.SetRetrievalMode(RetrievalMode::EXHAUSTIVE);
+    max_score.SetRetrievalMode(RetrievalMode::MAX_SCORE);
+    // Words are drawn with falling frequency, so that common terms become non-essential, and the posting
+    // lists are long enough to be split into windows. A small vocabulary and few ratings give many documents
+    // with equal text, so most relevances tie and the order falls to the rating and id.
+    mt19937 generator(42);
+    discrete_distribution<size_t> word_distribution({ 40, 20, 12, 8, 6, 4, 3, 2, 1, 1 });
+    for (int document_id = 0; document_id < 40000; ++document_id) {
+        string text;
+        const size_t word_count = 1 + generator() % 4;
+        for (size_t i = 0; i < word_count; ++i) {
+            text += words[word_distribution(generator)] + " "s;
+        }
+        text += "in the"s;
+        const DocumentStatus status = statuses[generator() % 4];
+        const vector<int> ratings = { static_cast<int>(generator() % 3) };
+        exhaustive.AddDocument(document_id, text, status, ratings);
+        max_score.AddDocument(document_id, text, status, ratings);
+    }
+
+    AttributeFilter filter;
+    filter.min_rating = 1;
+    filter.status_mask = DocumentStatusBit(DocumentStatus::ACTUAL) | DocumentStatusBit(DocumentStatus::BANNED);
+    const auto is_even = [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 0;
+    };
+    for (const string& query : { "cat"s, "cat dog"s, "cat dog john"s, "cat dog bird fish pigeon"s, "cat -dog"s,
+                                 "cat dog hat -bird -fish"s, "cat bird tail eyes -john"s, "cat -cat"s, "unknown"s }) {
+        for (const size_t max_count : { size_t{1}, size_t{5}, size_t{50}, size_t{3000} }) {
+            AssertEqualDocuments(exhaustive.FindTopDocuments(query, DocumentStatus::ACTUAL, max_count),
+                                 max_score.FindTopDocuments(query, DocumentStatus::ACTUAL, max_count), query);
+            AssertEqualDocuments(exhaustive.FindTopDocuments(query, DocumentStatus::BANNED, max_count),
+                                 max_score.FindTopDocuments(query, DocumentStatus::BANNED, max_count), query);
+            AssertEqualDocuments(exhaustive.FindTopDocuments(query, is_even, max_count),
+                                 max_score.FindTopDocuments(query, is_even, max_count), query);
+            AssertEqualDocuments(exhaustive.FindTopDocuments(query, filter, max_count),
+                                 max_score.FindTopDocuments(query, filter, max_count), query);
+            AssertEqualDocuments(exhaustive.FindTopDocuments(execution::par, query, is_even, max_count),
+                                 max_score.FindTopDocuments(execution::par, query, is_even, max_count), query);
+        }
+    }
+}
+
+string ReadFileBytes(const string& path) {
+    ifstream in(path, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+void WriteFileBytes(const string& path, const string& bytes) {
+    ofstream(path, ios::binary) << bytes;
+}
+
+void TestSnapshotRoundTrip() {
+    const string path = (filesystem::temp_directory_path() / "search_server_test_snapshot.bin"s).string();
+    const string corrupted_path = path + ".corrupted"s;
+    SearchServer server("in the"s);
+    for (int document_id = 0; document_id < 200; ++document_id) {
+        const string text = "cat in the city "s + (document_id % 3 == 0 ? "dog "s : ""s) + "word"s + to_string(document_id % 17);
+        server.AddDocument(document_id * 2, text, static_cast<DocumentStatus>(document_id % 3), { document_id % 5 });
+    }
+    server.RemoveDocument(10);
+    server.SaveSnapshot(path);
+
+    SearchServer loaded(""s);
+    loaded.LoadSnapshot(path);
+    const MappedSearchServer mapped(path);
+    ASSERT(mapped.VerifyChecksum());
+    ASSERT_EQUAL(loaded.GetDocumentCount(), server.GetDocumentCount());
+    ASSERT_EQUAL(mapped.GetDocumentCount(), server.GetDocumentCount());
+    for (const string& query : { "cat"s, "dog word3"s, "city -dog"s, "word5 word7 -in"s, "unknown"s }) {
+        for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::IRRELEVANT, DocumentStatus::BANNED }) {
+            const auto expected = server.FindTopDocuments(query, status, 50);
+            AssertEqualDocuments(loaded.FindTopDocuments(query, status, 50), expected, query);
+            AssertEqualDocuments(mapped.FindTopDocuments(query, status, 50), expected, query);
+        }
+    }
+    ASSERT(loaded.GetWordFrequencies(12) == server.GetWordFrequencies(12));
+    ASSERT(mapped.GetWordFrequencies(12) == server.GetWordFrequencies(12));
+
+    // Every broken file is rejected, and a failed load leaves the server as it was
+    const string bytes = ReadFileBytes(path);
+    const auto is_rejected = [&corrupted_path, &loaded](bool check_mapped) {
+        bool load_failed = false;
+        try {
+            loaded.LoadSnapshot(corrupted_path);
+        }
+        catch (const runtime_error&) {
+            load_failed = true;
+        }
+        bool open_failed = !check_mapped;
+        if (check_mapped) {
+            try {
+                MappedSearchServer corrupted(corrupted_path);
+            }
+            catch (const runtime_error&) {
+                open_failed = true;
+            }
+        }
+        return load_failed && open_failed && loaded.GetDocumentCount() == 199;
+    };
+    // The payload ends with the forward term frequencies, so the last byte changes a value but not the layout.
+    // Opening a mapped file does not read the payload; VerifyChecksum finds the change.
+    string corrupted = bytes;
+    corrupted.back() ^= 1;
+    WriteFileBytes(corrupted_path, corrupted);
+    ASSERT(is_rejected(false));
+    ASSERT(!MappedSearchServer(corrupted_path).VerifyChecksum());
+
+    WriteFileBytes(corrupted_path, bytes.substr(0, bytes.size() - 8));
+    ASSERT(is_rejected(true));
+
+    corrupted = bytes;
+    SnapshotHeader header;
+    memcpy(&header, corrupted.data(), sizeof(header));
+    ++header.format_version;
+    memcpy(corrupted.data(), &header, sizeof(header));
+    WriteFileBytes(corrupted_path, corrupted);
+    ASSERT(is_rejected(true));
+
+    filesystem::remove(path);
+    filesystem::remove(corrupted_path);
+}
+
+void TestMoveAssignment() {
+    SearchServer server("in the"s);
+    server.AddDocument(1, "white cat in the city"s, DocumentStatus::ACTUAL, { 1 });
+    {
+        SearchServer other("and"s);
+        for (int document_id = 10; document_id < 20; ++document_id) {
+            other.AddDocument(document_id, "curly dog and "s + to_string(document_id), DocumentStatus::ACTUAL, { 2 });
+        }
+        other.RemoveDocument(15);
+        server = move(other);
+    }
+    ASSERT_EQUAL(server.GetDocumentCount(), 9);
+    ASSERT(server.FindTopDocuments("cat"s).empty());
+    ASSERT_EQUAL(server.FindTopDocuments("dog"s, DocumentStatus::ACTUAL, 20).size(), 9u);
+    // The moved index stays usable: its arena and id map keep growing and shrinking
+    for (int document_id = 20; document_id < 100; ++document_id) {
+        server.AddDocument(document_id, "curly dog "s + to_string(document_id), DocumentStatus::ACTUAL, { 2 });
+    }
+    for (int document_id = 10; document_id < 90; ++document_id) {
+        server.RemoveDocument(document_id);
+    }
+    ASSERT_EQUAL(server.FindTopDocuments("dog"s, DocumentStatus::ACTUAL, 20).size(), 10u);
+    const set<int>::const_iterator first = server.begin();
+    ASSERT_EQUAL(*first, 90);
+    ASSERT_EQUAL(distance(first, server.end()), 10);
+}
+
+void TestShardedMatchesSingleServer() {
+    const vector<string> words = { "cat"s, "dog"s, "bird"s, "fish"s, "city"s, "tail"s, "eyes"s, "hat"s };
+    SearchServer single("in the"s);
+    ShardedSearchServer sharded(3, "in the"s);
+    mt19937 generator(7);
+    vector<RawDocument> batch;
+    vector<string> texts;
+    texts.reserve(3000);
+    for (int document_id = 0; document_id < 3000; ++document_id) {
+        string& text = texts.emplace_back("in the"s);
+        const size_t word_count = 1 + generator() % 5;
+        for (size_t i = 0; i < word_count; ++i) {
+            text += " "s + words[generator() % (1 + document_id % words.size())];
+        }
+        const auto status = static_cast<DocumentStatus>(generator() % 3);
+        const vector<int> ratings = { static_cast<int>(generator() % 4) };
+        single.AddDocument(document_id, text, status, ratings);
+        // Half of the documents reach the shards one by one, the other half in a batch
+        if (document_id % 2 == 0) {
+            sharded.AddDocument(document_id, text, status, ratings);
+        }
+        else {
+            batch.push_back({ document_id, text, status, ratings });
+        }
+    }
+    for (const exception_ptr& error : sharded.AddDocuments(batch)) {
+        ASSERT(!error);
+    }
+
+    const auto check_queries = [&single, &sharded] {
+        ASSERT_EQUAL(sharded.GetDocumentCount(), single.GetDocumentCount());
+        const auto has_odd_rating = [](int, DocumentStatus, int rating) {
+            return rating % 2 == 1;
+        };
+        for (const string& query : { "cat"s, "hat"s, "cat dog eyes"s, "bird -cat"s, "fish city tail -hat -dog"s }) {
+            for (const size_t max_count : { size_t{1}, size_t{5}, size_t{100} }) {
+                AssertEqualDocuments(sharded.FindTopDocuments(query, DocumentStatus::ACTUAL, max_count),
+                                     single.FindTopDocuments(query, DocumentStatus::ACTUAL, max_count), query);
+                AssertEqualDocuments(sharded.FindTopDocuments(query, has_odd_rating, max_count),
+                                     single.FindTopDocuments(query, has_odd_rating, max_count), query);
+            }
+        }
+    };
+    check_queries();
+    // Removals change the document counts of single shards, which the corpus-wide IDF must follow
+    vector<int> removed_ids;
+    for (int document_id = 0; document_id < 3000; document_id += 7) {
+        removed_ids.push_back(document_id);
+        single.RemoveDocument(document_id);
+    }
+    sharded.RemoveDocuments(removed_ids);
+    sharded.RemoveDocument(1);
+    single.RemoveDocument(1);
+    check_queries();
+}
+
+void TestConcurrentReadersSeeWholeUpdates() {
+    ConcurrentSearchServer server("and"s);
+    const int update_count = 300;
+    atomic<bool> is_writing{ true };
+    atomic<bool> is_consistent{ true };
+    // Every update adds a pair of documents, so a reader that saw half an update would find an odd count
+    const auto read = [&server, &is_writing, &is_consistent] {
+        int last_count = 0;
+        bool is_last_read = false;
+        while (!is_last_read) {
+            is_last_read = !is_writing.load();
+            server.Read([&](const SearchServer& copy) {
+                const int count = copy.GetDocumentCount();
+                const size_t found_count = copy.FindTopDocuments("pair"s, DocumentStatus::ACTUAL, 10000).size();
+                if (count % 2 != 0 || count < last_count || found_count != static_cast<size_t>(count)) {
+                    is_consistent = false;
+                }
+                last_count = count;
+                });
+        }
+    };
+    vector<thread> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.emplace_back(read);
+    }
+    for (int k = 0; k < update_count; ++k) {
+        server.Update([k](SearchServer& copy) {
+            copy.AddDocument(2 * k, "pair and left"s, DocumentStatus::ACTUAL, { 1 });
+            copy.AddDocument(2 * k + 1, "pair and right"s, DocumentStatus::ACTUAL, { 1 });
+            });
+        // A finished update is visible to the next read
+        ASSERT_EQUAL(server.GetDocumentCount(), 2 * (k + 1));
+    }
+    is_writing = false;
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    ASSERT(is_consistent);
+
+    server.AddDocument(2 * update_count, "single"s, DocumentStatus::ACTUAL, { 1 });
+    server.RemoveDocument(0);
+    ASSERT_EQUAL(server.GetDocumentCount(), 2 * update_count);
+    ASSERT_EQUAL(server.FindTopDocuments("single"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("left"s, DocumentStatus::ACTUAL, 10000).size(), static_cast<size_t>(update_count - 1));
+    // Both copies received every change: the next update is applied on the other copy first
+    server.RemoveDocument(1);
+    ASSERT_EQUAL(server.FindTopDocuments("single"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("left"s, DocumentStatus::ACTUAL, 10000).size(), static_cast<size_t>(update_count - 1));
+    ASSERT_EQUAL(server.FindTopDocuments("right"s, DocumentStatus::ACTUAL, 10000).size(), static_cast<size_t>(update_count - 1));
+}
+
+void TestAddDocumentsReportsErrorsPerDocument() {
+    const auto is_invalid_argument = [](const exception_ptr& error) {
+        try {
+            rethrow_exception(error);
+        }
+        catch (const invalid_argument&) {
+            return true;
+        }
+        catch (...) {
+            return false;
+        }
+    };
+    const vector<RawDocument> batch = {
+        { 1, "fluffy cat"sv, DocumentStatus::ACTUAL, { 1 } },
+        { 2, "black dog"sv, DocumentStatus::ACTUAL, { 2 } },
+        { 3, "curly \x12tail"sv, DocumentStatus::ACTUAL, { 3 } },
+        { 4, "white cat"sv, DocumentStatus::BANNED, { 4 } },
+        { 2, "another dog"sv, DocumentStatus::ACTUAL, { 5 } },
+        { -5, "nasty cat"sv, DocumentStatus::ACTUAL, { 6 } },
+        { 10, "existing cat"sv, DocumentStatus::ACTUAL, { 7 } },
+        { 6, "parrot"sv, DocumentStatus::ACTUAL, { 8 } },
+    };
+    for (const bool is_parallel : { false, true }) {
+        SearchServer server("and"s);
+        server.AddDocument(10, "old parrot"s, DocumentStatus::ACTUAL, { 9 });
+        const vector<exception_ptr> errors = is_parallel ? server.AddDocuments(execution::par, batch)
+                                                         : server.AddDocuments(batch);
+        ASSERT_EQUAL(errors.size(), batch.size());
+        // An invalid word, a repeated id within the batch, a negative id and an id already in the index
+        for (const size_t i : { 2, 4, 5, 6 }) {
+            ASSERT_HINT(is_invalid_argument(errors[i]), to_string(i));
+        }
+        for (const size_t i : { 0, 1, 3, 7 }) {
+            ASSERT_HINT(!errors[i], to_string(i));
+        }
+
+        ASSERT_EQUAL(server.GetDocumentCount(), 5);
+        const auto cats = server.FindTopDocuments("cat"s);
+        ASSERT_EQUAL(cats.size(), 1u);
+        ASSERT_EQUAL(cats[0].id, 1);
+        ASSERT_EQUAL(server.FindTopDocuments("cat"s, DocumentStatus::BANNED).size(), 1u);
+        ASSERT_EQUAL(server.FindTopDocuments("dog"s)[0].rating, 2);
+        ASSERT(server.FindTopDocuments("curly"s).empty());
+        ASSERT(server.FindTopDocuments("another"s).empty());
+        ASSERT(server.FindTopDocuments("existing"s).empty());
+        ASSERT_EQUAL(server.FindTopDocuments("parrot"s).size(), 2u);
+        ASSERT(server.GetWordFrequencies(10) == (map<string_view, double>{ { "old"sv, 0.5 }, { "parrot"sv, 0.5 } }));
+    }
+}
+
+void TestFindDuplicateDocuments() {
+    for (const RemovalMode mode : { RemovalMode::IMMEDIATE, RemovalMode::TOMBSTONE }) {
+        SearchServer server("and with"s);
+        server.SetRemovalMode(mode);
+        server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+        server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+        server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+        // The same words with other frequencies, and in another order
+        server.AddDocument(4, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+        server.AddDocument(5, "rat nasty and pet funny"s, DocumentStatus::BANNED, { 1, 2 });
+        server.AddDocument(6, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+        // A subset of the words of another document is not a duplicate
+        server.AddDocument(7, "curly hair"s, DocumentStatus::ACTUAL, { 1, 2 });
+        server.AddDocument(8, "hair nasty rat curly rat"s, DocumentStatus::ACTUAL, { 1, 2 });
+        ASSERT_EQUAL(server.FindDuplicateDocuments(), (vector<int>{ 3, 4, 5, 8 }));
+        ASSERT_EQUAL(server.FindDuplicateDocuments(execution::par), (vector<int>{ 3, 4, 5, 8 }));
+
+        // A removed document is neither reported nor kept as the original of others
+        server.RemoveDocument(4);
+        ASSERT_EQUAL(server.FindDuplicateDocuments(), (vector<int>{ 3, 5, 8 }));
+        server.RemoveDocument(1);
+        ASSERT_EQUAL(server.FindDuplicateDocuments(), (vector<int>{ 3, 8 }));
+        RemoveDuplicates(server);
+        ASSERT(server.FindDuplicateDocuments().empty());
+        ASSERT_EQUAL(server.GetDocumentCount(), 4);
+        ASSERT_EQUAL(vector<int>(server.begin(), server.end()), (vector<int>{ 2, 5, 6, 7 }));
+    }
+}
+
+void TestProcessQueriesJoined() {
+    SearchServer server("and"s);
+    for (int document_id = 0; document_id < 500; ++document_id) {
+        server.AddDocument(document_id, "cat w"s + to_string(document_id % 50) + " w"s + to_string(document_id % 37),
+                           DocumentStatus::ACTUAL, { document_id % 7 });
+    }
+    // Enough queries for more than two chunks, the last of them partial
+    vector<string> queries;
+    for (size_t i = 0; i < 2 * PROCESS_QUERIES_CHUNK_SIZE + 10; ++i) {
+        queries.push_back("w"s + to_string(i % 60) + " -w"s + to_string(i % 41));
+    }
+    vector<Document> expected;
+    for (const string& query : queries) {
+        const vector<Document> documents = server.FindTopDocuments(query);
+        expected.insert(expected.end(), documents.begin(), documents.end());
+    }
+    AssertEqualDocuments(ProcessQueriesJoined(server, queries), expected, "joined"s);
+    ASSERT(ProcessQueriesJoined(server, {}).empty());
+}
+
 // Функция TestSearchServer является точкой входа для запуска тестов
 void TestSearchServer() {
-    RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
+    /*RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
     RUN_TEST(TestAddDocuments);
     RUN_TEST(TestExcludeMinusWordsFromAddedDocumentContent);
     RUN_TEST(TestMatchDocuments);
@@ -322,5 +715,14 @@ void TestSearchServer() {
     RUN_TEST(TestCalculatingRatingDocuments);
     RUN_TEST(TestFilteringSearchResults);
     RUN_TEST(TestSearchDocementsByStatus);
-    RUN_TEST(TestRelevanceSearchDocuments);
-}*/
\ No newline at end of file
+    RUN_TEST(TestRelevanceSearchDocuments);*/
+    RUN_TEST(TestRemoveFromCompressedPostings);
+    RUN_TEST(TestMaxScoreMatchesExhaustive);
+    RUN_TEST(TestSnapshotRoundTrip);
+    RUN_TEST(TestMoveAssignment);
+    RUN_TEST(TestShardedMatchesSingleServer);
+    RUN_TEST(TestConcurrentReadersSeeWholeUpdates);
+    RUN_TEST(TestAddDocumentsReportsErrorsPerDocument);
+    RUN_TEST(TestFindDuplicateDocuments);
+    RUN_TEST(TestProcessQueriesJoined);
+}
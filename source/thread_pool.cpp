@@ -0,0 +1,130 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <optional>
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    for (size_t i = 0; i < std::max<size_t>(thread_count, 1); ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this, i] {
+            WorkerLoop(i);
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard guard(mutex_);
+        is_stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::Shared() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+void ThreadPool::Submit(Job& job, size_t count) {
+    // Counted before the tasks are queued, so a worker that sees no tasks yet spins instead of sleeping
+    queued_count_.fetch_add(count, std::memory_order_acq_rel);
+    const size_t queue_count = queues_.size();
+    const size_t first_queue = next_queue_.fetch_add(1, std::memory_order_relaxed);
+    for (size_t k = 0; k < std::min(count, queue_count); ++k) {
+        WorkQueue& queue = *queues_[(first_queue + k) % queue_count];
+        std::lock_guard guard(queue.mutex);
+        for (size_t index = k; index < count; index += queue_count) {
+            queue.items.push_back({ &job, index });
+        }
+    }
+    {
+        std::lock_guard guard(mutex_);
+    }
+    wake_.notify_all();
+}
+
+void ThreadPool::Wait(Job& job) {
+    while (job.remaining.load(std::memory_order_acquire) > 0 && RunQueuedTask(queues_.size())) {
+    }
+    std::unique_lock lock(job.mutex);
+    job.done.wait(lock, [&job] {
+        return job.is_done;
+        });
+    if (job.error) {
+        std::rethrow_exception(job.error);
+    }
+}
+
+void ThreadPool::WorkerLoop(size_t queue_index) {
+    while (true) {
+        if (RunQueuedTask(queue_index)) {
+            continue;
+        }
+        std::unique_lock lock(mutex_);
+        wake_.wait(lock, [this] {
+            return is_stopping_ || queued_count_.load(std::memory_order_acquire) > 0;
+            });
+        if (is_stopping_) {
+            return;
+        }
+    }
+}
+
+// Takes a task from the front of the given queue, or steals one from the back of another;
+// an index past the last queue only steals
+bool ThreadPool::RunQueuedTask(size_t queue_index) {
+    const auto pop = [this](size_t index, bool from_front) -> std::optional<WorkItem> {
+        WorkQueue& queue = *queues_[index];
+        std::lock_guard guard(queue.mutex);
+        if (queue.items.empty()) {
+            return std::nullopt;
+        }
+        WorkItem item = from_front ? queue.items.front() : queue.items.back();
+        if (from_front) {
+            queue.items.pop_front();
+        }
+        else {
+            queue.items.pop_back();
+        }
+        queued_count_.fetch_sub(1, std::memory_order_acq_rel);
+        return item;
+    };
+
+    const size_t queue_count = queues_.size();
+    std::optional<WorkItem> item;
+    if (queue_index < queue_count) {
+        item = pop(queue_index, true);
+    }
+    for (size_t k = 1; k <= queue_count && !item; ++k) {
+        item = pop((queue_index + k) % queue_count, false);
+    }
+    if (!item) {
+        return false;
+    }
+    Execute(*item);
+    return true;
+}
+
+void ThreadPool::Execute(const WorkItem& item) {
+    Job& job = *item.job;
+    try {
+        job.run(job.task, item.index);
+    }
+    catch (...) {
+        std::lock_guard guard(job.mutex);
+        if (!job.error) {
+            job.error = std::current_exception();
+        }
+    }
+    // The waiting thread returns only after seeing is_done under the lock, so the job outlives this call
+    if (job.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard guard(job.mutex);
+        job.is_done = true;
+        job.done.notify_all();
+    }
+}